@@ -1,6 +1,7 @@
 #version 460 core
 
 layout (location = 0) out vec4 f_color0;
+layout (location = 1) out vec4 f_normal; // for DiffuseGI, ignored without a second draw buffer
 
 layout (binding = 0) uniform sampler2D u_diffuseTex;
 layout (binding = 1) uniform sampler2D u_specularTex;
@@ -21,6 +22,10 @@ in VS_OUT
 
 void main()
 {
+    // Two-sided materials face the camera from either side
+    vec3 normal = normalize(fs_in.normal);
+    f_normal = vec4(gl_FrontFacing ? normal : -normal, 0);
+
     if (u_hasMap[0]) {
         vec4 color = vec4(texture(u_diffuseTex, fs_in.texCoord));
         if (u_hasMap[7]) {
@@ -4,8 +4,11 @@ layout (location = 0) in vec3 a_position;
 layout (location = 1) in vec3 a_normal;
 layout (location = 2) in vec2 a_texCoord;
 
-uniform mat4 u_view;
-uniform mat4 u_proj;
+#include "include/frame_uniforms.glsl"
+#include "include/vertex_packing.glsl"
+
+uniform bool u_packedVertices;
+uniform vec3 u_meshAABB[2];
 
 out VS_OUT
 {
@@ -13,10 +16,10 @@ out VS_OUT
     vec2 texCoord;
 } vs_out;
 
-
 void main()
 {
-    vs_out.normal = a_normal;
+    vec3 position = u_packedVertices ? mix(u_meshAABB[0], u_meshAABB[1], a_position) : a_position;
+    vs_out.normal = u_packedVertices ? OctDecode(a_normal.xy) : a_normal;
     vs_out.texCoord = a_texCoord;
-    gl_Position = u_proj * u_view * vec4(a_position, 1);
+    gl_Position = u_viewProj * vec4(position, 1);
 }
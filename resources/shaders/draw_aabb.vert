@@ -1,8 +1,6 @@
 #version 460 core
 
-uniform vec3 u_sceneAABB[2];
-uniform mat4 u_proj;
-uniform mat4 u_view;
+#include "include/frame_uniforms.glsl"
 
 void main()
 {
@@ -30,8 +28,8 @@ void main()
         5, 7,
         6, 7);
 
-    vec3 pos = mix(u_sceneAABB[0], u_sceneAABB[1], 
+    vec3 pos = mix(u_sceneAABB[0].xyz, u_sceneAABB[1].xyz, 
                    vertices[indices[gl_VertexID]]);
 
-    gl_Position = u_proj * u_view * vec4(pos, 1);
+    gl_Position = u_viewProj * vec4(pos, 1);
 }
\ No newline at end of file
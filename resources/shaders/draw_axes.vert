@@ -7,8 +7,7 @@ out VS_OUT
     vec4 color;
 } vs_out;
 
-uniform mat4 u_proj;
-uniform mat4 u_view;
+#include "include/frame_uniforms.glsl"
 
 void main()
 {
@@ -22,7 +21,7 @@ void main()
 
     uint colorIndex = gl_VertexID / 2;
 
-    gl_Position = u_proj * u_view * vertices[gl_VertexID];
+    gl_Position = u_viewProj * vertices[gl_VertexID];
 
     vs_out.color = (colorIndex == 0) ? vec4(1, 0, 0, 1) :
                    (colorIndex == 1) ? vec4(0, 1, 0, 1) :
@@ -0,0 +1,49 @@
+#version 460 core
+
+#include "include/frame_uniforms.glsl"
+#include "include/svo.glsl"
+
+layout (location = 0) out vec4 f_color;
+
+in VS_OUT
+{
+    vec2 texCoord;
+} fs_in;
+
+/* Draw the sparse voxel octree
+ * Ray march from the camera through the octree for every pixel of a full screen quad, the hit voxel is
+ * colored by its position like in draw_voxels and written with its depth.
+ */
+
+void main()
+{
+    mat4 invViewProj = inverse(u_viewProj);
+    vec2 ndc = fs_in.texCoord * 2 - 1;
+    vec4 nearPoint = invViewProj * vec4(ndc, -1, 1);
+    vec4 farPoint = invViewProj * vec4(ndc, 1, 1);
+    vec3 rayOrigin = nearPoint.xyz / nearPoint.w;
+    vec3 rayDirection = normalize(farPoint.xyz / farPoint.w - rayOrigin);
+
+    // Voxel space, t stays in world units
+    vec3 voxelScale = SVO_RESOLUTION / (u_sceneAABB[1].xyz - u_sceneAABB[0].xyz);
+    vec3 origin = (rayOrigin - u_sceneAABB[0].xyz) * voxelScale;
+    vec3 direction = rayDirection * voxelScale;
+
+    vec3 t0 = (vec3(0) - origin) / direction;
+    vec3 t1 = (vec3(SVO_RESOLUTION) - origin) / direction;
+    vec3 tNear = min(t0, t1);
+    vec3 tFar = max(t0, t1);
+    float tMin = max(max(max(tNear.x, tNear.y), tNear.z), 0);
+    float tMax = min(min(tFar.x, tFar.y), tFar.z);
+
+    uint color;
+    float t;
+    if (tMin >= tMax || !SvoTraceRay(origin, direction, tMin, tMax, color, t)) {
+        discard;
+    }
+
+    vec3 voxel = floor(clamp(origin + direction * t, vec3(0), vec3(SVO_RESOLUTION - 1)));
+    f_color = vec4(voxel / SVO_RESOLUTION, 1);
+    vec4 clipPosition = u_viewProj * vec4(rayOrigin + rayDirection * t, 1);
+    gl_FragDepth = clipPosition.z / clipPosition.w * 0.5 + 0.5;
+}
@@ -1,7 +1,12 @@
 #version 460 core
 
-layout (r32ui, binding = 0) uniform coherent readonly uimage3D u_voxelImage;
-uniform uint u_voxelResolution;
+#include "include/color.glsl"
+
+layout (r32ui, binding = VOXEL_IMAGE_BINDING) uniform coherent readonly uimage3D u_voxelImage;
+layout (binding = VOXEL_MIP_TEXTURE_UNIT) uniform sampler3D u_voxelMip;
+
+uniform int u_mipLevel; // -1 draws the R32UI volume, otherwise this level of the mip volume
+uniform int u_mipDirection;
 
 /* Draw voxels
  * 1. Generate lattice from gl_VertexID
@@ -12,22 +17,23 @@ uniform uint u_voxelResolution;
 out VS_OUT
 {
     vec4 color;
+    float size; // of a voxel relative to the volume
 } vs_out;
 
-vec4 UnpackColor(uint uColor)
-{
-    return vec4(((uColor & 0xff000000) >> 24) / 255,
-               ((uColor & 0xff0000) >> 16) / 255,
-               ((uColor & 0xff00) >> 8) / 255,
-               (uColor & 0xff) / 255);
-}
-
 void main()
 {
-    ivec3 imageCoord = ivec3(gl_VertexID % u_voxelResolution,
-                           (gl_VertexID / u_voxelResolution) % u_voxelResolution,
-                            gl_VertexID / (u_voxelResolution * u_voxelResolution));
+    int resolution = (u_mipLevel < 0) ? VOXEL_RESOLUTION : (VOXEL_MIP_RESOLUTION >> u_mipLevel);
+    ivec3 imageCoord = ivec3(gl_VertexID % resolution,
+                           (gl_VertexID / resolution) % resolution,
+                            gl_VertexID / (resolution * resolution));
 
-    vs_out.color = UnpackColor(imageLoad(u_voxelImage, imageCoord).r);
-    gl_Position = vec4(imageCoord, 1);
+    if (u_mipLevel < 0) {
+        vs_out.color = UnpackColor(imageLoad(u_voxelImage, imageCoord).r);
+    }
+    else {
+        // Directions are side by side along x, see include/voxel_mipmap.glsl
+        vs_out.color = texelFetch(u_voxelMip, ivec3(imageCoord.x + u_mipDirection * resolution, imageCoord.yz), u_mipLevel);
+    }
+    vs_out.size = 1.0 / resolution;
+    gl_Position = vec4(vec3(imageCoord) * vs_out.size, 1);
 }
@@ -0,0 +1,28 @@
+#version 460 core
+
+layout (location = 0) out vec4 f_color0;
+
+layout (binding = GI_GBUFFER_TEXTURE_UNIT) uniform sampler2D u_albedoTex;
+layout (binding = GI_GBUFFER_TEXTURE_UNIT + 2) uniform sampler2D u_depthTex;
+layout (binding = GI_TEXTURE_UNIT + 1) uniform sampler2D u_giTex;
+
+uniform float u_strength;
+uniform bool u_indirectOnly; // the GI alone, without the albedo
+
+in VS_OUT
+{
+    vec2 texCoord;
+} fs_in;
+
+// Albedo lit by the upsampled GI, the G-buffer depth goes along for the passes drawn on top
+void main()
+{
+    float depth = texture(u_depthTex, fs_in.texCoord).r;
+    if (depth == 1) {
+        discard; // background, keeps the clear color
+    }
+    vec3 indirect = texture(u_giTex, fs_in.texCoord).rgb * u_strength;
+    vec3 albedo = texture(u_albedoTex, fs_in.texCoord).rgb;
+    f_color0 = vec4(u_indirectOnly ? indirect : albedo * indirect, 1);
+    gl_FragDepth = depth;
+}
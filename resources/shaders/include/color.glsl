@@ -0,0 +1,17 @@
+// RGBA8 packed into the r32ui voxel image, red in the most significant byte
+
+uint PackColor(vec4 color)
+{
+    return ((uint(color.r * 255) & 0xff) << 24) | 
+           ((uint(color.g * 255) & 0xff) << 16) | 
+           ((uint(color.b * 255) & 0xff) << 8) | 
+           ((uint(color.a * 255) & 0xff));
+}
+
+vec4 UnpackColor(uint uColor)
+{
+    return vec4(((uColor & 0xff000000) >> 24) / 255.0,
+                ((uColor & 0xff0000) >> 16) / 255.0,
+                ((uColor & 0xff00) >> 8) / 255.0,
+                (uColor & 0xff) / 255.0);
+}
@@ -0,0 +1,58 @@
+// Cone tracing through the anisotropic voxel mip volume, see include/voxel_mipmap.glsl
+// The volume spans u_sceneAABB, distances are measured in voxels of mip level 0 along the longest axis.
+
+#include "frame_uniforms.glsl"
+#include "voxel_mipmap.glsl"
+
+layout (binding = VOXEL_MIP_TEXTURE_UNIT) uniform sampler3D u_voxelMip;
+
+// Accumulated opacity at which a cone stops
+#define CONE_OPACITY_CUTOFF 0.95
+
+float VoxelSize()
+{
+    vec3 extent = u_sceneAABB[1].xyz - u_sceneAABB[0].xyz;
+    return max(extent.x, max(extent.y, extent.z)) / VOXEL_MIP_RESOLUTION;
+}
+
+/*
+ * The volume as seen by a cone travelling along direction: the three faces facing it are blended by the
+ * squared direction components, which sum to one. uvw is the position in the volume, level may be fractional.
+ */
+vec4 SampleVoxelMip(vec3 uvw, vec3 direction, float level)
+{
+    // Half a texel of the coarser level in from the edges, so no direction bleeds into its neighbour along x
+    float halfTexel = 0.5 * exp2(ceil(level)) / VOXEL_MIP_RESOLUTION;
+    float u = clamp(uvw.x, halfTexel, 1 - halfTexel);
+    ivec3 faces = ivec3(direction.x < 0 ? 1 : 0,
+                        direction.y < 0 ? 3 : 2,
+                        direction.z < 0 ? 5 : 4);
+    vec3 weights = direction * direction;
+    return weights.x * textureLod(u_voxelMip, vec3((faces.x + u) / VOXEL_MIP_DIRECTIONS, uvw.yz), level) +
+           weights.y * textureLod(u_voxelMip, vec3((faces.y + u) / VOXEL_MIP_DIRECTIONS, uvw.yz), level) +
+           weights.z * textureLod(u_voxelMip, vec3((faces.z + u) / VOXEL_MIP_DIRECTIONS, uvw.yz), level);
+}
+
+/*
+ * Premultiplied radiance and opacity gathered front to back along a cone from origin, which should already be
+ * off the surface. The sample diameter grows with the distance, the level follows it and the step is
+ * stepSize diameters. Stops when opaque, after maxDistance voxels or on leaving the volume.
+ */
+vec4 TraceCone(vec3 origin, vec3 direction, float tanHalfAngle, float stepSize, float maxDistance)
+{
+    float voxelSize = VoxelSize();
+    vec3 volumeOrigin = u_sceneAABB[0].xyz;
+    vec3 invExtent = 1.0 / (u_sceneAABB[1].xyz - u_sceneAABB[0].xyz);
+    vec4 result = vec4(0);
+    float distance = voxelSize;
+    while (distance < maxDistance * voxelSize && result.a < CONE_OPACITY_CUTOFF) {
+        vec3 uvw = (origin + direction * distance - volumeOrigin) * invExtent;
+        if (any(lessThan(uvw, vec3(0))) || any(greaterThan(uvw, vec3(1)))) {
+            break;
+        }
+        float diameter = max(voxelSize, 2 * tanHalfAngle * distance);
+        result = Composite(result, SampleVoxelMip(uvw, direction, log2(diameter / voxelSize)));
+        distance += diameter * stepSize;
+    }
+    return result;
+}
@@ -0,0 +1,10 @@
+// Written once per frame by the application, mirrors FrameUniforms in main.cpp
+
+layout (std140, binding = FRAME_UNIFORMS_BINDING) uniform FrameUniforms
+{
+    mat4 u_view;
+    mat4 u_proj;
+    mat4 u_viewProj;
+    vec4 u_sceneAABB[2]; // xyz used
+    vec4 u_cameraPosition;
+};
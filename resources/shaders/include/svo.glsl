@@ -0,0 +1,141 @@
+// Sparse voxel octree, built by SparseVoxelOctree, see sparse_voxel_octree.h
+// A node holds the index of its first child, the 8 children of a node are consecutive. Nodes of the last
+// level hold the index of a brick of 2x2x2 packed colors instead. 0 means no children: node 0 is the root
+// and brick 0 is kept empty. Children are ordered x | y << 1 | z << 2.
+
+#define SVO_RESOLUTION (1 << SVO_LEVELS)
+#define SVO_GROUP_SIZE 64
+#define SVO_NODE_FLAG 0x80000000u // set on a node that needs children, only while building
+#define SVO_CHILD_MASK 0x7fffffffu
+#define SVO_NULL 0xffffffffu
+#define SVO_MAX_STEPS 512
+
+layout (std430, binding = SVO_NODE_BINDING) buffer SvoNodes
+{
+    uint u_svoNodes[];
+};
+
+layout (std430, binding = SVO_BRICK_BINDING) buffer SvoBricks
+{
+    uint u_svoBricks[]; // PackColor, 8 per brick
+};
+
+uint SvoChildIndex(uvec3 voxel, uint depth)
+{
+    uvec3 bit = (voxel >> (SVO_LEVELS - 1 - depth)) & 1u;
+    return bit.x | (bit.y << 1) | (bit.z << 2);
+}
+
+// Node at depth containing voxel, SVO_NULL if the tree ends above it
+uint SvoFindNode(uvec3 voxel, uint depth)
+{
+    uint node = 0;
+    for (uint i = 0; i < depth; ++i) {
+        uint child = u_svoNodes[node] & SVO_CHILD_MASK;
+        if (child == 0) {
+            return SVO_NULL;
+        }
+        node = child + SvoChildIndex(voxel, i);
+    }
+    return node;
+}
+
+// Packed color of a voxel, 0 if empty
+uint SvoLookup(uvec3 voxel)
+{
+    uint node = SvoFindNode(voxel, SVO_LEVELS - 1);
+    if (node == SVO_NULL) {
+        return 0;
+    }
+    uint brick = u_svoNodes[node] & SVO_CHILD_MASK;
+    return u_svoBricks[brick * 8 + SvoChildIndex(voxel, SVO_LEVELS - 1)];
+}
+
+/* First occupied voxel along origin + t * direction for t in [tMin, tMax], in voxel space
+ * Every step descends from the root as far as the tree goes at the current point and then jumps
+ * to the exit of the empty node it ended in, so empty space is crossed a whole node at a time.
+ */
+bool SvoTraceRay(vec3 origin, vec3 direction, float tMin, float tMax, out uint color, out float t)
+{
+    vec3 invDirection = 1.0 / mix(direction, vec3(1e-8), lessThan(abs(direction), vec3(1e-8)));
+    float epsilon = 1e-3 / max(max(abs(direction.x), abs(direction.y)), abs(direction.z));
+    t = tMin;
+    for (int i = 0; i < SVO_MAX_STEPS && t <= tMax; ++i) {
+        uvec3 voxel = uvec3(clamp(origin + direction * t, vec3(0), vec3(SVO_RESOLUTION - 1)));
+
+        uint node = 0;
+        uint cellSize = SVO_RESOLUTION;
+        for (uint depth = 0; depth < SVO_LEVELS; ++depth) {
+            uint child = u_svoNodes[node] & SVO_CHILD_MASK;
+            if (child == 0) {
+                break;
+            }
+            cellSize >>= 1;
+            if (depth == SVO_LEVELS - 1) {
+                color = u_svoBricks[child * 8 + SvoChildIndex(voxel, depth)];
+                if (color != 0) {
+                    return true;
+                }
+                break;
+            }
+            node = child + SvoChildIndex(voxel, depth);
+        }
+
+        vec3 cellMin = vec3(voxel & ~uvec3(cellSize - 1));
+        vec3 exits = (cellMin + step(vec3(0), direction) * float(cellSize) - origin) * invDirection;
+        t = min(min(exits.x, exits.y), exits.z) + epsilon;
+    }
+    color = 0;
+    return false;
+}
+
+#ifdef SVO_BUILD
+
+// One per voxel covered by the voxelize pass, duplicates included
+struct SvoFragment
+{
+    uint positionXY; // x | y << 16
+    uint positionZ;
+    uint color;
+};
+
+layout (std430, binding = SVO_FRAGMENT_BINDING) buffer SvoFragments
+{
+    SvoFragment u_svoFragments[];
+};
+
+// Mirrors SparseVoxelOctree::Counters
+layout (std430, binding = SVO_COUNTER_BINDING) buffer SvoCounters
+{
+    uint fragmentCount;
+    uint nodeCount;
+    uint brickCount;
+    uint fragmentCapacity;
+    uint nodeCapacity;
+    uint brickCapacity;
+    uint allocateGroups[3];
+    uint levelStart[SVO_LEVELS + 1];
+} u_svoCounters;
+
+SvoFragment MakeSvoFragment(uvec3 voxel, uint color)
+{
+    return SvoFragment(voxel.x | (voxel.y << 16), voxel.z, color);
+}
+
+uvec3 SvoFragmentPosition(SvoFragment fragment)
+{
+    return uvec3(fragment.positionXY & 0xffffu, fragment.positionXY >> 16, fragment.positionZ);
+}
+
+// Dispatches are wrapped into y past 65535 groups, see SparseVoxelOctree::Dispatch
+uint SvoInvocationIndex()
+{
+    return (gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x) * SVO_GROUP_SIZE + gl_LocalInvocationIndex;
+}
+
+uint SvoFragmentCount()
+{
+    return min(u_svoCounters.fragmentCount, u_svoCounters.fragmentCapacity);
+}
+
+#endif
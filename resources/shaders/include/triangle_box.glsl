@@ -0,0 +1,36 @@
+// Triangle/box overlap by the separating axis theorem (Akenine-Moller): the 3 box normals, the triangle
+// normal and the 9 cross products of box and triangle edges. Exact, thin triangles are not missed.
+
+bool TriangleBoxOverlap(vec3 boxCenter, vec3 boxHalfSize, vec3 a, vec3 b, vec3 c)
+{
+    vec3 v0 = a - boxCenter;
+    vec3 v1 = b - boxCenter;
+    vec3 v2 = c - boxCenter;
+
+    // Box normals, the AABB of the triangle against the box
+    if (any(greaterThan(min(min(v0, v1), v2), boxHalfSize)) || any(lessThan(max(max(v0, v1), v2), -boxHalfSize))) {
+        return false;
+    }
+
+    // Triangle normal
+    vec3 edges[3] = vec3[3](v1 - v0, v2 - v1, v0 - v2);
+    vec3 normal = cross(edges[0], edges[1]);
+    if (abs(dot(normal, v0)) > dot(boxHalfSize, abs(normal))) {
+        return false;
+    }
+
+    // Edge cross products
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            vec3 boxEdge = vec3(0);
+            boxEdge[j] = 1;
+            vec3 axis = cross(boxEdge, edges[i]);
+            vec3 p = vec3(dot(v0, axis), dot(v1, axis), dot(v2, axis));
+            float r = dot(boxHalfSize, abs(axis));
+            if (min(min(p.x, p.y), p.z) > r || max(max(p.x, p.y), p.z) < -r) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
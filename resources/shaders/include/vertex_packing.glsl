@@ -0,0 +1,10 @@
+// Packed layout: position is unorm16 relative to the mesh AABB, normal is octahedral snorm16, see vertex_packing.h
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1 - abs(e.x) - abs(e.y));
+    if (n.z < 0) {
+        n.xy = (1 - abs(n.yx)) * vec2(n.x >= 0 ? 1 : -1, n.y >= 0 ? 1 : -1);
+    }
+    return normalize(n);
+}
@@ -0,0 +1,30 @@
+// Anisotropic mip volume of the voxels, see voxel_mipmap.h
+// Level l holds VOXEL_MIP_RESOLUTION >> l voxels per axis for each of the 6 directions +x, -x, +y, -y, +z, -z,
+// side by side along x: direction d starts at x = d * (VOXEL_MIP_RESOLUTION >> l). Colors are premultiplied.
+
+#define VOXEL_MIP_DIRECTIONS 6
+
+// front over back, both premultiplied
+vec4 Composite(vec4 front, vec4 back)
+{
+    return front + (1 - front.a) * back;
+}
+
+/*
+ * What a 2x2x2 block looks like to a cone travelling along the direction: the two voxels in line with
+ * it are composited front to back and the four resulting columns averaged. block is indexed x + 2y + 4z.
+ */
+vec4 ReduceDirection(vec4 block[8], int direction)
+{
+    const int step = 1 << (direction / 2);
+    const bool negative = (direction & 1) != 0;
+    vec4 sum = vec4(0);
+    for (int i = 0; i < 8; ++i) {
+        if ((i & step) == 0) {
+            vec4 lower = block[i];
+            vec4 upper = block[i | step];
+            sum += negative ? Composite(upper, lower) : Composite(lower, upper);
+        }
+    }
+    return sum * 0.25;
+}
@@ -0,0 +1,16 @@
+// Projection of the raster voxelizer, shared by voxelize.geom and the per-axis draws of voxelize.vert
+
+#include "frame_uniforms.glsl"
+
+vec3 ToNDC(vec3 v)
+{
+    return vec3(((v - u_sceneAABB[0].xyz) / (u_sceneAABB[1].xyz - u_sceneAABB[0].xyz) - vec3(0.5)) * 2);
+}
+
+// Makes the dominant axis face z, its own inverse so the fragment shader swizzles back with it
+vec3 SwizzleToAxis(vec3 v, int axis)
+{
+    return (axis == 0) ? v.zyx :
+           (axis == 1) ? v.xzy :
+           v;
+}
@@ -0,0 +1,106 @@
+// Shared by the passes of the compute voxelizer, see compute_voxelizer.h
+
+#include "color.glsl"
+#include "frame_uniforms.glsl"
+#include "triangle_box.glsl"
+
+#define VOXELIZE_TRIANGLE_GROUP_SIZE 128 // one invocation per triangle of a meshlet
+#define VOXELIZE_TILE_SIZE 8
+#define VOXELIZE_SMALL_TRIANGLE_VOXELS 64 // larger bounding boxes go through the tile queue
+
+layout (r32ui, binding = VOXEL_IMAGE_BINDING) uniform coherent uimage3D u_voxelImage;
+
+#if COLLECT_STATS
+layout (binding = VOXEL_COUNTER_BINDING, offset = 0) uniform atomic_uint u_voxelWrites;
+layout (binding = VOXEL_COUNTER_BINDING, offset = 4) uniform atomic_uint u_voxelCollisions;
+#endif
+
+// Layout of Meshlet in scene.h
+struct Meshlet
+{
+    vec4 boundingSphere;
+    vec4 coneApex;
+    vec4 coneAxisCutoff;
+    vec4 aabbMin;
+    vec4 aabbMax;
+    uint firstIndex;
+    uint indexCount;
+    uint baseVertex;
+    uint meshIndex;
+};
+
+layout (std430, binding = MESHLET_BUFFER_BINDING) readonly buffer Meshlets
+{
+    Meshlet u_meshlets[];
+};
+
+// Vertex in scene.h is 8 floats, the position comes first
+layout (std430, binding = VOXELIZE_VERTEX_BINDING) readonly buffer SceneVertices
+{
+    float u_vertices[];
+};
+
+layout (std430, binding = VOXELIZE_INDEX_BINDING) readonly buffer SceneIndices
+{
+    uint u_indices[];
+};
+
+// Large triangle and one tile of VOXELIZE_TILE_SIZE^3 voxels its bounding box covers
+struct TileEntry
+{
+    uint triangle; // meshlet << 7 | triangle in the meshlet
+    uint tile;     // x | y << 10 | z << 20
+};
+
+// Mirrors ComputeVoxelizer::Counters
+layout (std430, binding = VOXELIZE_QUEUE_BINDING) buffer TileQueue
+{
+    uint queueCount;
+    uint smallTriangles;
+    uint largeTriangles;
+    uint fallbackTriangles; // did not fit in the queue, voxelized by their own invocation
+    TileEntry u_tileQueue[];
+};
+
+uniform uint u_queueCapacity;
+
+// Corners of a triangle in voxel space
+void LoadTriangle(uint meshletIndex, uint triangle, out vec3 corners[3])
+{
+    Meshlet meshlet = u_meshlets[meshletIndex];
+    vec3 scale = VOXEL_RESOLUTION / (u_sceneAABB[1].xyz - u_sceneAABB[0].xyz);
+    for (int i = 0; i < 3; ++i) {
+        uint vertex = (u_indices[meshlet.firstIndex + triangle * 3 + i] + meshlet.baseVertex) * 8;
+        vec3 position = vec3(u_vertices[vertex], u_vertices[vertex + 1], u_vertices[vertex + 2]);
+        corners[i] = (position - u_sceneAABB[0].xyz) * scale;
+    }
+}
+
+void WriteVoxel(ivec3 imageCoord)
+{
+    // Same color as the raster path
+    uint color = PackColor(vec4(1, 0, 0, 1));
+#if COLLECT_STATS
+    uint previous = imageAtomicExchange(u_voxelImage, imageCoord, color);
+    atomicCounterIncrement(u_voxelWrites);
+    if (previous != 0) {
+        atomicCounterIncrement(u_voxelCollisions);
+    }
+#else
+    imageAtomicExchange(u_voxelImage, imageCoord, color);
+#endif
+}
+
+// Test and write every voxel of [first, last]
+void VoxelizeRange(ivec3 first, ivec3 last, vec3 corners[3])
+{
+    for (int z = first.z; z <= last.z; ++z) {
+        for (int y = first.y; y <= last.y; ++y) {
+            for (int x = first.x; x <= last.x; ++x) {
+                if (TriangleBoxOverlap(vec3(x, y, z) + 0.5, vec3(0.5), corners[0], corners[1], corners[2])) {
+                    WriteVoxel(ivec3(x, y, z));
+                }
+            }
+        }
+    }
+}
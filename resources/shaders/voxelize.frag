@@ -1,39 +1,69 @@
 #version 460 core
 
-layout (r32ui, binding = 0) uniform coherent uimage3D u_voxelImage;
+#include "include/color.glsl"
+
+#if SVO_FRAGMENT_LIST
+// The fragments are appended to the list the octree is built from instead of written to the volume
+#define SVO_BUILD 1
+#include "include/svo.glsl"
+#define GRID_RESOLUTION SVO_RESOLUTION
+#else
+#define GRID_RESOLUTION VOXEL_RESOLUTION
+#endif
+
+layout (r32ui, binding = VOXEL_IMAGE_BINDING) uniform coherent uimage3D u_voxelImage;
 layout (pixel_center_integer) in vec4 gl_FragCoord;
 
-uniform uint u_voxelResolution;
+#if COLLECT_STATS
+// Read back by VoxelStats, the volume is cleared before a measured run
+layout (binding = VOXEL_COUNTER_BINDING, offset = 0) uniform atomic_uint u_voxelWrites;
+layout (binding = VOXEL_COUNTER_BINDING, offset = 4) uniform atomic_uint u_voxelCollisions;
+#endif
 
 /* 
- * gl_FragCoord is in range of [0, 0, 0] - [VOXEL_RESOLUTION - 1, VOXEL_RESOLUTION - 1, 1]
- * imageCoord is in range of [0, 0, 0] - [VOXEL_RESOLUTION - 1, VOXEL_RESOLUTION - 1, VOXEL_RESOLUTION - 1]
+ * gl_FragCoord is in range of [0, 0, 0] - [GRID_RESOLUTION - 1, GRID_RESOLUTION - 1, 1]
+ * imageCoord is in range of [0, 0, 0] - [GRID_RESOLUTION - 1, GRID_RESOLUTION - 1, GRID_RESOLUTION - 1]
  */
 
+#if AXIS_DRAWS
+uniform int u_dominantAxis;
+#else
 in GS_OUT
 {
     flat int dominantAxis;
 } fs_in;
-
-uint PackColor(vec4 color)
-{
-    return ((uint(color.r * 255) & 0xff) << 24) | 
-           ((uint(color.g * 255) & 0xff) << 16) | 
-           ((uint(color.b * 255) & 0xff) << 8) | 
-           ((uint(color.a * 255) & 0xff));
-}
+#endif
 
 void main()
 {
+#if AXIS_DRAWS
+    const int dominantAxis = u_dominantAxis;
+#else
+    const int dominantAxis = fs_in.dominantAxis;
+#endif
     ivec3 imageCoord;
     imageCoord.xy = ivec2(gl_FragCoord.xy);
-    imageCoord.z = int(gl_FragCoord.z * u_voxelResolution);
-    imageCoord = (fs_in.dominantAxis == 0) ? imageCoord.zyx :
-                 (fs_in.dominantAxis == 1) ? imageCoord.xzy :
+    imageCoord.z = min(int(gl_FragCoord.z * GRID_RESOLUTION), GRID_RESOLUTION - 1);
+    imageCoord = (dominantAxis == 0) ? imageCoord.zyx :
+                 (dominantAxis == 1) ? imageCoord.xzy :
                  imageCoord;
 
-    // vec3 color = vec3(vec2(imageCoord.xy) / u_voxelResolution, 0);
+    // vec3 color = vec3(vec2(imageCoord.xy) / VOXEL_RESOLUTION, 0);
     vec3 color = vec3(1, 0, 0);
 
+#if SVO_FRAGMENT_LIST
+    // Past the capacity only counted, the list is grown and the scene voxelized again
+    uint index = atomicAdd(u_svoCounters.fragmentCount, 1u);
+    if (index < u_svoCounters.fragmentCapacity) {
+        u_svoFragments[index] = MakeSvoFragment(uvec3(imageCoord), PackColor(vec4(color, 1)));
+    }
+#elif COLLECT_STATS
+    uint previous = imageAtomicExchange(u_voxelImage, imageCoord, PackColor(vec4(color, 1)));
+    atomicCounterIncrement(u_voxelWrites);
+    if (previous != 0) {
+        atomicCounterIncrement(u_voxelCollisions);
+    }
+#else
     imageAtomicExchange(u_voxelImage, imageCoord, PackColor(vec4(color, 1)));
-}
\ No newline at end of file
+#endif
+}
@@ -4,16 +4,33 @@ layout (location = 0) in vec3 a_position;
 layout (location = 1) in vec3 a_normal;
 layout (location = 2) in vec2 a_texCoord;
 
+#include "include/vertex_packing.glsl"
+#if AXIS_DRAWS
+#include "include/voxel_projection.glsl"
+#endif
+
+uniform bool u_packedVertices;
+uniform vec3 u_meshAABB[2];
+#if AXIS_DRAWS
+// Every triangle of the draw has this dominant axis, see axis_streams.h
+uniform int u_dominantAxis;
+#endif
+
 out VS_OUT 
 {
     vec3 normal;
     vec2 texCoord;
 } vs_out;
 
-// Pass through information to geometry shader
+// Pass through information to geometry shader, or project right away when the triangles come sorted by axis
 void main()
 {
-    vs_out.normal = a_normal;
+    vs_out.normal = u_packedVertices ? OctDecode(a_normal.xy) : a_normal;
     vs_out.texCoord = a_texCoord;
-    gl_Position = vec4(a_position, 1);
-}
\ No newline at end of file
+    vec3 position = u_packedVertices ? mix(u_meshAABB[0], u_meshAABB[1], a_position) : a_position;
+#if AXIS_DRAWS
+    gl_Position = vec4(SwizzleToAxis(ToNDC(position), u_dominantAxis), 1);
+#else
+    gl_Position = vec4(position, 1);
+#endif
+}
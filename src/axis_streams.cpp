@@ -0,0 +1,42 @@
+#include "axis_streams.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <cstring>
+
+uint32_t DominantAxis(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+    glm::vec3 n = glm::abs(glm::cross(p1 - p0, p2 - p0));
+    return (n.x > n.y && n.x > n.z) ? 0 :
+           (n.y > n.x && n.y > n.z) ? 1 : 2;
+}
+
+void SortTrianglesByAxis(const SceneView& scene, std::vector<uint32_t>& outIndices, std::vector<AxisIndexRanges>& outRanges)
+{
+    PROFILE_FUNCTION();
+    outIndices.resize(scene.indexCount);
+    outRanges.assign(scene.meshletCount, AxisIndexRanges{});
+
+    // Meshes are independent and write disjoint ranges of both outputs
+    GetThreadPool().ParallelFor(scene.meshCount, [&](uint32_t meshIndex) {
+        const auto& mesh = scene.meshes[meshIndex];
+        const Vertex* vertices = scene.vertices + mesh.firstVertex;
+        uint32_t cursor = mesh.firstIndex;
+        for (uint32_t axis = 0; axis < 3; ++axis) {
+            for (uint32_t i = mesh.firstMeshlet; i < mesh.firstMeshlet + mesh.meshletCount; ++i) {
+                const auto& meshlet = scene.meshlets[i];
+                auto& range = outRanges[i];
+                range.firstIndex[axis] = cursor;
+                for (uint32_t j = meshlet.firstIndex; j < meshlet.firstIndex + meshlet.indexCount; j += 3) {
+                    const uint32_t* triangle = scene.indices + j;
+                    if (DominantAxis(vertices[triangle[0]].position, vertices[triangle[1]].position, 
+                                     vertices[triangle[2]].position) == axis) {
+                        std::memcpy(outIndices.data() + cursor, triangle, 3 * sizeof(uint32_t));
+                        cursor += 3;
+                    }
+                }
+                range.indexCount[axis] = cursor - range.firstIndex[axis];
+            }
+        }
+    });
+}
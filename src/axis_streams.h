@@ -0,0 +1,28 @@
+#pragma once
+
+#include "scene.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/* Index streams for voxelization without a geometry shader
+ * The raster voxelizer projects every triangle along the axis its normal is dominant along. Sorting the
+ * triangles by that axis ahead of time turns the voxelization into three plain draws with a fixed swizzle
+ * each. Every mesh keeps its range of the index buffer, inside it the triangles of all its meshlets with
+ * dominant axis x come first, then y, then z, so a meshlet has one contiguous range per axis.
+ */
+
+// Where the triangles of a meshlet went, firstIndex is into the sorted index buffer like Meshlet::firstIndex
+struct AxisIndexRanges
+{
+    uint32_t firstIndex[3]{ 0 };
+    uint32_t indexCount[3]{ 0 };
+};
+
+// Same classification as DominantAxis() in voxelize.geom, ties go to the later axis
+uint32_t DominantAxis(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2);
+
+// outIndices has the size and mesh ranges of SceneView::indices, outRanges has one entry per meshlet
+void SortTrianglesByAxis(const SceneView& scene, std::vector<uint32_t>& outIndices, std::vector<AxisIndexRanges>& outRanges);
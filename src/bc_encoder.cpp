@@ -0,0 +1,516 @@
+#include "bc_encoder.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define VCT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+// Structure-of-arrays copy of a block, one row of 16 floats per channel
+struct BlockSoA
+{
+    alignas(16) float c[4][16];
+};
+
+void ToSoA(const uint8_t block[64], BlockSoA& out)
+{
+    for (uint32_t i = 0; i < 16; ++i) {
+        for (uint32_t k = 0; k < 4; ++k) {
+            out.c[k][i] = block[4 * i + k];
+        }
+    }
+}
+
+/*
+ * Project every pixel onto the segment e0 -> e1 of the first channelCount channels,
+ * starting at channel firstChannel, and quantize the position into (levels - 1) uniform steps.
+ */
+void ComputeSteps(const BlockSoA& b, uint32_t firstChannel, uint32_t channelCount,
+                  const float* e0, const float* e1, uint32_t levels, uint8_t steps[16])
+{
+    float d[4] = { 0 };
+    float len2 = 0;
+    for (uint32_t k = 0; k < channelCount; ++k) {
+        d[k] = e1[k] - e0[k];
+        len2 += d[k] * d[k];
+    }
+    if (len2 < 1e-8f) {
+        std::memset(steps, 0, 16);
+        return;
+    }
+    const float scale = (levels - 1) / len2;
+
+#ifdef VCT_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxStep = _mm_set1_ps(static_cast<float>(levels - 1));
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128i quantized[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+        __m128 t = zero;
+        for (uint32_t k = 0; k < channelCount; ++k) {
+            __m128 p = _mm_sub_ps(_mm_load_ps(&b.c[firstChannel + k][4 * i]), _mm_set1_ps(e0[k]));
+            t = _mm_add_ps(t, _mm_mul_ps(p, _mm_set1_ps(d[k] * scale)));
+        }
+        t = _mm_min_ps(_mm_max_ps(t, zero), maxStep);
+        quantized[i] = _mm_cvttps_epi32(_mm_add_ps(t, half));
+    }
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(quantized[0], quantized[1]),
+                                      _mm_packs_epi32(quantized[2], quantized[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(steps), packed);
+#else
+    for (uint32_t i = 0; i < 16; ++i) {
+        float t = 0;
+        for (uint32_t k = 0; k < channelCount; ++k) {
+            t += (b.c[firstChannel + k][i] - e0[k]) * d[k] * scale;
+        }
+        t = std::clamp(t, 0.f, static_cast<float>(levels - 1));
+        steps[i] = static_cast<uint8_t>(t + 0.5f);
+    }
+#endif
+}
+
+// Endpoints of the block along the principal axis of the first channelCount channels
+void PrincipalEndpoints(const BlockSoA& b, uint32_t channelCount, float outMin[4], float outMax[4])
+{
+    float mean[4] = { 0 };
+    for (uint32_t k = 0; k < channelCount; ++k) {
+        for (uint32_t i = 0; i < 16; ++i) {
+            mean[k] += b.c[k][i];
+        }
+        mean[k] /= 16;
+    }
+
+    float cov[4][4] = { { 0 } };
+    for (uint32_t i = 0; i < 16; ++i) {
+        for (uint32_t k = 0; k < channelCount; ++k) {
+            for (uint32_t l = k; l < channelCount; ++l) {
+                cov[k][l] += (b.c[k][i] - mean[k]) * (b.c[l][i] - mean[l]);
+            }
+        }
+    }
+    for (uint32_t k = 0; k < channelCount; ++k) {
+        for (uint32_t l = 0; l < k; ++l) {
+            cov[k][l] = cov[l][k];
+        }
+    }
+
+    // Power iteration, converges quickly for the 3x3/4x4 case
+    float axis[4] = { 1, 1, 1, 1 };
+    for (uint32_t iter = 0; iter < 8; ++iter) {
+        float next[4] = { 0 };
+        float norm = 0;
+        for (uint32_t k = 0; k < channelCount; ++k) {
+            for (uint32_t l = 0; l < channelCount; ++l) {
+                next[k] += cov[k][l] * axis[l];
+            }
+            norm = std::max(norm, std::abs(next[k]));
+        }
+        if (norm < 1e-6f) {
+            break;
+        }
+        for (uint32_t k = 0; k < channelCount; ++k) {
+            axis[k] = next[k] / norm;
+        }
+    }
+
+    float tMin = 0, tMax = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        float t = 0;
+        for (uint32_t k = 0; k < channelCount; ++k) {
+            t += (b.c[k][i] - mean[k]) * axis[k];
+        }
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+
+    float len2 = 0;
+    for (uint32_t k = 0; k < channelCount; ++k) {
+        len2 += axis[k] * axis[k];
+    }
+    if (len2 > 0) {
+        tMin /= len2;
+        tMax /= len2;
+    }
+
+    for (uint32_t k = 0; k < channelCount; ++k) {
+        outMin[k] = std::clamp(mean[k] + tMin * axis[k], 0.f, 255.f);
+        outMax[k] = std::clamp(mean[k] + tMax * axis[k], 0.f, 255.f);
+    }
+}
+
+uint16_t To565(const float c[3])
+{
+    auto r = static_cast<uint32_t>(c[0] * 31 / 255 + 0.5f);
+    auto g = static_cast<uint32_t>(c[1] * 63 / 255 + 0.5f);
+    auto b = static_cast<uint32_t>(c[2] * 31 / 255 + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void From565(uint16_t c, float out[3])
+{
+    uint32_t r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    out[0] = static_cast<float>((r << 3) | (r >> 2));
+    out[1] = static_cast<float>((g << 2) | (g >> 4));
+    out[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+void EncodeBC1(const BlockSoA& b, uint8_t out[8])
+{
+    float lo[4], hi[4];
+    PrincipalEndpoints(b, 3, lo, hi);
+
+    // Inset the endpoints by 1/16 of the range, the outermost pixels rarely sit on the axis
+    for (uint32_t k = 0; k < 3; ++k) {
+        float inset = (hi[k] - lo[k]) / 16;
+        lo[k] += inset;
+        hi[k] -= inset;
+    }
+
+    uint16_t c0 = To565(hi);
+    uint16_t c1 = To565(lo);
+    // c0 > c1 selects the 4-color mode
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        float e0[3], e1[3];
+        From565(c0, e0);
+        From565(c1, e1);
+
+        uint8_t steps[16];
+        ComputeSteps(b, 0, 3, e0, e1, 4, steps);
+
+        constexpr uint32_t STEP_TO_INDEX[4] = { 0, 2, 3, 1 };
+        for (uint32_t i = 0; i < 16; ++i) {
+            indices |= STEP_TO_INDEX[steps[i]] << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    std::memcpy(out + 4, &indices, 4);
+}
+
+void EncodeBC4(const BlockSoA& b, uint32_t channel, uint8_t out[8])
+{
+    float lo = 255, hi = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        lo = std::min(lo, b.c[channel][i]);
+        hi = std::max(hi, b.c[channel][i]);
+    }
+
+    // r0 > r1 selects the 8-value mode
+    auto r0 = static_cast<uint8_t>(hi + 0.5f);
+    auto r1 = static_cast<uint8_t>(lo + 0.5f);
+
+    uint64_t indices = 0;
+    if (r0 != r1) {
+        float e0 = r0, e1 = r1;
+        uint8_t steps[16];
+        ComputeSteps(b, channel, 1, &e0, &e1, 8, steps);
+
+        for (uint32_t i = 0; i < 16; ++i) {
+            uint64_t index = steps[i] == 0 ? 0 :
+                             steps[i] == 7 ? 1 :
+                             steps[i] + 1;
+            indices |= index << (3 * i);
+        }
+    }
+
+    out[0] = r0;
+    out[1] = r1;
+    for (uint32_t i = 0; i < 6; ++i) {
+        out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+    }
+}
+
+// Mode 6: one subset, 7-bit RGBA endpoints with a unique p-bit each, 4-bit indices
+void EncodeBC7(const BlockSoA& b, uint8_t out[16])
+{
+    float lo[4], hi[4];
+    PrincipalEndpoints(b, 4, lo, hi);
+
+    uint32_t q[2][4];
+    uint32_t p[2];
+    float expanded[2][4];
+    const float* endpoints[2] = { lo, hi };
+    for (uint32_t e = 0; e < 2; ++e) {
+        float bestErr = 0;
+        for (uint32_t pbit = 0; pbit < 2; ++pbit) {
+            uint32_t candidate[4];
+            float err = 0;
+            for (uint32_t k = 0; k < 4; ++k) {
+                float v = (endpoints[e][k] - pbit) / 2;
+                candidate[k] = static_cast<uint32_t>(std::clamp(v + 0.5f, 0.f, 127.f));
+                float recon = static_cast<float>((candidate[k] << 1) | pbit);
+                err += (recon - endpoints[e][k]) * (recon - endpoints[e][k]);
+            }
+            if (pbit == 0 || err < bestErr) {
+                bestErr = err;
+                p[e] = pbit;
+                std::memcpy(q[e], candidate, sizeof(candidate));
+            }
+        }
+        for (uint32_t k = 0; k < 4; ++k) {
+            expanded[e][k] = static_cast<float>((q[e][k] << 1) | p[e]);
+        }
+    }
+
+    uint8_t steps[16];
+    ComputeSteps(b, 0, 4, expanded[0], expanded[1], 16, steps);
+
+    // The anchor index is stored with its MSB implied to be zero
+    if (steps[0] >= 8) {
+        std::swap(q[0], q[1]);
+        std::swap(p[0], p[1]);
+        for (uint32_t i = 0; i < 16; ++i) {
+            steps[i] = 15 - steps[i];
+        }
+    }
+
+    uint64_t bits[2] = { 0, 0 };
+    uint32_t pos = 0;
+    auto Write = [&](uint64_t value, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i, ++pos) {
+            bits[pos / 64] |= ((value >> i) & 1) << (pos % 64);
+        }
+    };
+
+    Write(1 << 6, 7);
+    for (uint32_t k = 0; k < 4; ++k) {
+        Write(q[0][k], 7);
+        Write(q[1][k], 7);
+    }
+    Write(p[0], 1);
+    Write(p[1], 1);
+    Write(steps[0], 3);
+    for (uint32_t i = 1; i < 16; ++i) {
+        Write(steps[i], 4);
+    }
+
+    std::memcpy(out, bits, 16);
+}
+
+// Writes the RGB of all 16 pixels, and the alpha when writeAlpha. BC3 always uses the 4-color mode.
+void DecodeBC1(const uint8_t in[8], bool fourColorsOnly, bool writeAlpha, uint8_t block[64])
+{
+    const uint16_t c0 = static_cast<uint16_t>(in[0] | (in[1] << 8));
+    const uint16_t c1 = static_cast<uint16_t>(in[2] | (in[3] << 8));
+    float palette[4][4];
+    From565(c0, palette[0]);
+    From565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    const bool fourColors = fourColorsOnly || c0 > c1;
+    for (uint32_t k = 0; k < 3; ++k) {
+        if (fourColors) {
+            palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+            palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+        }
+        else {
+            palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+            palette[3][k] = 0;
+        }
+    }
+    if (!fourColors) {
+        palette[3][3] = 0;
+    }
+
+    uint32_t indices;
+    std::memcpy(&indices, in + 4, 4);
+    for (uint32_t i = 0; i < 16; ++i) {
+        const float* color = palette[(indices >> (2 * i)) & 3];
+        for (uint32_t k = 0; k < (writeAlpha ? 4u : 3u); ++k) {
+            block[4 * i + k] = static_cast<uint8_t>(color[k] + 0.5f);
+        }
+    }
+}
+
+void DecodeBC4(const uint8_t in[8], uint32_t channel, uint8_t block[64])
+{
+    const uint32_t r0 = in[0], r1 = in[1];
+    uint32_t values[8] = { r0, r1 };
+    for (uint32_t i = 2; i < 8; ++i) {
+        values[i] = (r0 > r1) ? ((8 - i) * r0 + (i - 1) * r1 + 3) / 7 :
+                    (i < 6) ? ((6 - i) * r0 + (i - 1) * r1 + 2) / 5 :
+                    (i == 6) ? 0 : 255;
+    }
+
+    uint64_t indices = 0;
+    for (uint32_t i = 0; i < 6; ++i) {
+        indices |= uint64_t{ in[2 + i] } << (8 * i);
+    }
+    for (uint32_t i = 0; i < 16; ++i) {
+        block[4 * i + channel] = static_cast<uint8_t>(values[(indices >> (3 * i)) & 7]);
+    }
+}
+
+// Mode 6 only, any other mode decodes as the transparent black the format defines for reserved modes
+void DecodeBC7(const uint8_t in[16], uint8_t block[64])
+{
+    uint64_t bits[2];
+    std::memcpy(bits, in, 16);
+    uint32_t pos = 0;
+    auto Read = [&](uint32_t count) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < count; ++i, ++pos) {
+            value |= static_cast<uint32_t>((bits[pos / 64] >> (pos % 64)) & 1) << i;
+        }
+        return value;
+    };
+
+    if (Read(7) != (1 << 6)) {
+        std::memset(block, 0, 64);
+        return;
+    }
+    uint32_t endpoints[2][4];
+    for (uint32_t k = 0; k < 4; ++k) {
+        endpoints[0][k] = Read(7);
+        endpoints[1][k] = Read(7);
+    }
+    const uint32_t p[2] = { Read(1), Read(1) };
+    for (uint32_t e = 0; e < 2; ++e) {
+        for (uint32_t k = 0; k < 4; ++k) {
+            endpoints[e][k] = (endpoints[e][k] << 1) | p[e];
+        }
+    }
+
+    constexpr uint32_t WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    for (uint32_t i = 0; i < 16; ++i) {
+        const uint32_t w = WEIGHTS[Read(i == 0 ? 3 : 4)];
+        for (uint32_t k = 0; k < 4; ++k) {
+            block[4 * i + k] = static_cast<uint8_t>(((64 - w) * endpoints[0][k] + w * endpoints[1][k] + 32) >> 6);
+        }
+    }
+}
+
+}
+
+const char* BlockFormatName(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    case BlockFormat::BC4: return "BC4";
+    case BlockFormat::BC5: return "BC5";
+    case BlockFormat::BC7: return "BC7";
+    }
+    return "?";
+}
+
+uint32_t BlockSize(BlockFormat format)
+{
+    return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+
+size_t CompressedImageSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+    return size_t{ (width + 3) / 4 } * ((height + 3) / 4) * BlockSize(format);
+}
+
+void EncodeBlock(BlockFormat format, const uint8_t block[64], uint8_t* out)
+{
+    BlockSoA b;
+    ToSoA(block, b);
+
+    switch (format) {
+    case BlockFormat::BC1:
+        EncodeBC1(b, out);
+        break;
+    case BlockFormat::BC3:
+        EncodeBC4(b, 3, out);
+        EncodeBC1(b, out + 8);
+        break;
+    case BlockFormat::BC4:
+        EncodeBC4(b, 0, out);
+        break;
+    case BlockFormat::BC5:
+        EncodeBC4(b, 0, out);
+        EncodeBC4(b, 1, out + 8);
+        break;
+    case BlockFormat::BC7:
+        EncodeBC7(b, out);
+        break;
+    }
+}
+
+void CompressImage(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* out)
+{
+    PROFILE_FUNCTION();
+    const uint32_t blockSize = BlockSize(format);
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+
+    uint8_t block[64];
+    for (uint32_t by = 0; by < blocksY; ++by) {
+        for (uint32_t bx = 0; bx < blocksX; ++bx) {
+            for (uint32_t y = 0; y < 4; ++y) {
+                uint32_t srcY = std::min(by * 4 + y, height - 1);
+                for (uint32_t x = 0; x < 4; ++x) {
+                    uint32_t srcX = std::min(bx * 4 + x, width - 1);
+                    std::memcpy(block + 4 * (4 * y + x), rgba + 4 * (size_t{ srcY } * width + srcX), 4);
+                }
+            }
+            EncodeBlock(format, block, out);
+            out += blockSize;
+        }
+    }
+}
+
+void DecodeBlock(BlockFormat format, const uint8_t* in, uint8_t block[64])
+{
+    for (uint32_t i = 0; i < 16; ++i) {
+        block[4 * i + 0] = block[4 * i + 1] = block[4 * i + 2] = 0;
+        block[4 * i + 3] = 255;
+    }
+
+    switch (format) {
+    case BlockFormat::BC1:
+        DecodeBC1(in, false, true, block);
+        break;
+    case BlockFormat::BC3:
+        DecodeBC1(in + 8, true, false, block);
+        DecodeBC4(in, 3, block);
+        break;
+    case BlockFormat::BC4:
+        DecodeBC4(in, 0, block);
+        break;
+    case BlockFormat::BC5:
+        DecodeBC4(in, 0, block);
+        DecodeBC4(in + 8, 1, block);
+        break;
+    case BlockFormat::BC7:
+        DecodeBC7(in, block);
+        break;
+    }
+}
+
+void DecompressImage(BlockFormat format, const uint8_t* in, uint32_t width, uint32_t height, uint8_t* rgba)
+{
+    const uint32_t blockSize = BlockSize(format);
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+
+    uint8_t block[64];
+    for (uint32_t by = 0; by < blocksY; ++by) {
+        for (uint32_t bx = 0; bx < blocksX; ++bx) {
+            DecodeBlock(format, in, block);
+            in += blockSize;
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y) {
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x) {
+                    std::memcpy(rgba + 4 * (size_t{ by * 4 + y } * width + bx * 4 + x), block + 4 * (4 * y + x), 4);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/* Block compression encoders
+ * All encoders take 4x4 RGBA8 blocks and do not depend on GL, so they can run on
+ * worker threads and in headless tools. Endpoints come from the principal axis of
+ * the block, the per-pixel index selection is vectorized with SSE2 when available.
+ * The decoders are reference implementations for checking the encoders without a GPU.
+ */
+
+enum class BlockFormat : uint32_t
+{
+    BC1, // RGB, 4 bpp
+    BC3, // RGBA, BC1 color + BC4 alpha, 8 bpp
+    BC4, // R, 4 bpp
+    BC5, // RG, two BC4 blocks, 8 bpp
+    BC7, // RGBA, mode 6 only, 8 bpp
+};
+
+const char* BlockFormatName(BlockFormat format);
+
+// Bytes per 4x4 block
+uint32_t BlockSize(BlockFormat format);
+
+size_t CompressedImageSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// rgba holds width * height * 4 bytes, out must hold CompressedImageSize() bytes.
+// Partial edge blocks are padded by clamping to the image border.
+void CompressImage(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* out);
+
+// block holds 16 RGBA8 pixels in row-major order
+void EncodeBlock(BlockFormat format, const uint8_t block[64], uint8_t* out);
+
+// Inverse of EncodeBlock, channels a format does not store decode as 0 for color and 255 for alpha.
+// BC7 decodes mode 6 only, the one mode the encoder writes.
+void DecodeBlock(BlockFormat format, const uint8_t* in, uint8_t block[64]);
+
+// Inverse of CompressImage, rgba receives width * height * 4 bytes
+void DecompressImage(BlockFormat format, const uint8_t* in, uint32_t width, uint32_t height, uint8_t* rgba);
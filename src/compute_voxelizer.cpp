@@ -0,0 +1,141 @@
+#include "compute_voxelizer.h"
+#include "profiler.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+constexpr const char* VOXELIZE_TRIANGLES_CS_PATH = "resources/shaders/voxelize_triangles.comp";
+constexpr const char* VOXELIZE_TILES_CS_PATH = "resources/shaders/voxelize_tiles.comp";
+
+constexpr size_t TILE_ENTRY_SIZE = 2 * sizeof(uint32_t);
+
+// Minimum GL_MAX_COMPUTE_WORK_GROUP_COUNT, larger dispatches wrap into y
+constexpr uint32_t MAX_GROUPS_X = 65535;
+
+}
+
+void ComputeVoxelizer::SubmitShaders(ShaderCompiler& compiler)
+{
+    for (int collectStats = 0; collectStats < 2; ++collectStats) {
+        ShaderDefines permutation{ MakeDefine("COLLECT_STATS", collectStats) };
+        compiler.Submit(m_trianglePrograms[collectStats], "voxelize_triangles",
+                        { { VOXELIZE_TRIANGLES_CS_PATH, GL_COMPUTE_SHADER } }, false, permutation);
+        compiler.Submit(m_tilePrograms[collectStats], "voxelize_tiles",
+                        { { VOXELIZE_TILES_CS_PATH, GL_COMPUTE_SHADER } }, false, permutation);
+    }
+}
+
+bool ComputeVoxelizer::IsReady(const ShaderCompiler& compiler, bool collectStats) const
+{
+    return compiler.IsReady(m_trianglePrograms[collectStats]) && compiler.IsReady(m_tilePrograms[collectStats]);
+}
+
+void ComputeVoxelizer::Create()
+{
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &m_storageAlignment);
+
+    glCreateBuffers(1, &m_queueBuffer);
+    glNamedBufferStorage(m_queueBuffer, sizeof(Counters) + size_t{ QUEUE_CAPACITY } * TILE_ENTRY_SIZE, nullptr, 0);
+
+    constexpr GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &m_readbackBuffer);
+    glNamedBufferStorage(m_readbackBuffer, FRAME_LATENCY * sizeof(Counters), nullptr, flags);
+    m_readback = static_cast<const Counters*>(glMapNamedBufferRange(m_readbackBuffer, 0, FRAME_LATENCY * sizeof(Counters), flags));
+}
+
+void ComputeVoxelizer::Destroy()
+{
+    for (auto& slot : m_slots) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        slot = Slot{};
+    }
+    glUnmapNamedBuffer(m_readbackBuffer);
+    glDeleteBuffers(1, &m_readbackBuffer);
+    glDeleteBuffers(1, &m_queueBuffer);
+    m_readbackBuffer = 0;
+    m_queueBuffer = 0;
+    m_readback = nullptr;
+}
+
+void ComputeVoxelizer::Voxelize(const ShaderCompiler& compiler, UploadRing& uploadRing, GLuint vertexBuffer, 
+                                GLuint indexBuffer, const std::vector<uint32_t>& meshlets, bool collectStats)
+{
+    PROFILE_FUNCTION();
+    if (meshlets.empty()) {
+        return;
+    }
+
+    uint32_t zero = 0;
+    glClearNamedBufferSubData(m_queueBuffer, GL_R32UI, 0, sizeof(Counters), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    size_t listBytes = meshlets.size() * sizeof(uint32_t);
+    auto allocation = uploadRing.AllocateTransient(listBytes, m_storageAlignment);
+    std::memcpy(allocation.data, meshlets.data(), listBytes);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, VOXELIZE_MESHLET_LIST_BINDING, uploadRing.Buffer(), allocation.offset, listBytes);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VOXELIZE_VERTEX_BINDING, vertexBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VOXELIZE_INDEX_BINDING, indexBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VOXELIZE_QUEUE_BINDING, m_queueBuffer);
+
+    const auto meshletCount = static_cast<uint32_t>(meshlets.size());
+    GLuint triangleProgram = m_trianglePrograms[collectStats];
+    glUseProgram(triangleProgram);
+    glProgramUniform1ui(triangleProgram, compiler.Reflection(triangleProgram).Location("u_meshletCount"), meshletCount);
+    glProgramUniform1ui(triangleProgram, compiler.Reflection(triangleProgram).Location("u_queueCapacity"), QUEUE_CAPACITY);
+    uint32_t groupsX = std::min(meshletCount, MAX_GROUPS_X);
+    glDispatchCompute(groupsX, (meshletCount + groupsX - 1) / groupsX, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    GLuint tileProgram = m_tilePrograms[collectStats];
+    glUseProgram(tileProgram);
+    glProgramUniform1ui(tileProgram, compiler.Reflection(tileProgram).Location("u_queueCapacity"), QUEUE_CAPACITY);
+    glDispatchCompute(TILE_GROUPS, 1, 1);
+
+    // Both passes write the volume with image atomics
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    auto& slot = m_slots[m_run % FRAME_LATENCY];
+    if (slot.fence) {
+        Resolve(slot);
+    }
+    glCopyNamedBufferSubData(m_queueBuffer, m_readbackBuffer, 0, (m_run % FRAME_LATENCY) * sizeof(Counters), sizeof(Counters));
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.meshlets = meshletCount;
+    ++m_run;
+}
+
+void ComputeVoxelizer::Resolve(Slot& slot)
+{
+    GLenum status = glClientWaitSync(slot.fence, 0, 0);
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return; // not done after FRAME_LATENCY runs, drop it rather than stall
+    }
+
+    const Counters& counters = m_readback[&slot - m_slots];
+    m_stats.meshlets = slot.meshlets;
+    m_stats.smallTriangles = counters.smallTriangles;
+    m_stats.largeTriangles = counters.largeTriangles;
+    m_stats.tileEntries = std::min(counters.queueCount, QUEUE_CAPACITY);
+    m_stats.fallbackTriangles = counters.fallbackTriangles;
+}
+
+void ComputeVoxelizer::Draw()
+{
+    // Oldest run first, so that the newest one that finished ends up shown
+    for (uint32_t i = 0; i < FRAME_LATENCY; ++i) {
+        auto& slot = m_slots[(m_run + i) % FRAME_LATENCY];
+        if (slot.fence && glClientWaitSync(slot.fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+            Resolve(slot);
+        }
+    }
+    const auto& stats = m_stats;
+    ImGui::Text("Meshlets: %u, triangles: %u small, %u large", stats.meshlets, stats.smallTriangles, stats.largeTriangles);
+    ImGui::Text("Tile entries: %u/%u, queue overflows: %u", stats.tileEntries, QUEUE_CAPACITY, stats.fallbackTriangles);
+}
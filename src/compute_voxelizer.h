@@ -0,0 +1,90 @@
+#pragma once
+
+#include "shader_compiler.h"
+#include "upload_ring.h"
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <vector>
+
+// Storage buffer bindings of include/voxelize_compute.glsl, the meshlets themselves are read at MESHLET_BUFFER_BINDING
+constexpr GLuint VOXELIZE_VERTEX_BINDING = 6;
+constexpr GLuint VOXELIZE_INDEX_BINDING = 7;
+constexpr GLuint VOXELIZE_MESHLET_LIST_BINDING = 8;
+constexpr GLuint VOXELIZE_QUEUE_BINDING = 9;
+
+// Work split of one run, resolved without stalling like VoxelStats
+struct ComputeVoxelizerStats
+{
+    uint32_t meshlets{ 0 };
+    uint32_t smallTriangles{ 0 };
+    uint32_t largeTriangles{ 0 };
+    uint32_t tileEntries{ 0 };
+    uint32_t fallbackTriangles{ 0 }; // large triangles that did not fit in the tile queue
+};
+
+/* Voxelization without the raster pipeline
+ * voxelize_triangles.comp runs one workgroup per meshlet and one invocation per triangle. Triangles with
+ * a small voxel bounding box test each voxel of it themselves; large ones are binned into tiles of 8^3
+ * voxels and every overlapped tile is queued for voxelize_tiles.comp, which tests one voxel per
+ * invocation. Both use an exact triangle/box SAT test, so unlike the raster path thin triangles are
+ * not missed and large ones are spread over many invocations instead of one geometry shader.
+ * Writes the same dense volume as VoxelizeScene, the COLLECT_STATS permutations feed VoxelStats.
+ */
+class ComputeVoxelizer
+{
+public:
+    static constexpr uint32_t QUEUE_CAPACITY = 1 << 20; // tile entries, 8 MB
+    static constexpr uint32_t TILE_GROUPS = 4096;       // the tile pass loops over the queue
+    static constexpr uint32_t FRAME_LATENCY = 3;        // runs in flight before their stats are read back
+
+    void SubmitShaders(ShaderCompiler& compiler);
+    bool IsReady(const ShaderCompiler& compiler, bool collectStats) const;
+
+    // Changes with every hot reload of the programs a run uses
+    GLuint TriangleProgram(bool collectStats) const { return m_trianglePrograms[collectStats]; }
+    GLuint TileProgram(bool collectStats) const { return m_tilePrograms[collectStats]; }
+
+    void Create();
+    void Destroy();
+
+    // Voxelizes the triangles of the listed meshlets into the image bound at VOXEL_IMAGE_BINDING, which the
+    // caller clears. vertexBuffer and indexBuffer hold the full precision scene geometry.
+    void Voxelize(const ShaderCompiler& compiler, UploadRing& uploadRing, GLuint vertexBuffer, GLuint indexBuffer,
+                  const std::vector<uint32_t>& meshlets, bool collectStats);
+
+    const ComputeVoxelizerStats& Stats() const { return m_stats; }
+    void Draw();
+
+private:
+    // std430 layout of the TileQueue header in include/voxelize_compute.glsl
+    struct Counters
+    {
+        uint32_t queueCount;
+        uint32_t smallTriangles;
+        uint32_t largeTriangles;
+        uint32_t fallbackTriangles;
+    };
+
+    // Readback of one run, reused FRAME_LATENCY runs later
+    struct Slot
+    {
+        GLsync fence{ nullptr };
+        uint32_t meshlets{ 0 };
+    };
+
+    void Resolve(Slot& slot);
+
+    GLuint m_trianglePrograms[2]{ 0 }; // indexed by collectStats
+    GLuint m_tilePrograms[2]{ 0 };
+    GLint m_storageAlignment{ 0 };
+
+    GLuint m_queueBuffer{ 0 };
+    GLuint m_readbackBuffer{ 0 };
+    const Counters* m_readback{ nullptr }; // FRAME_LATENCY entries, indexed like m_slots
+    Slot m_slots[FRAME_LATENCY];
+    uint32_t m_run{ 0 };
+
+    ComputeVoxelizerStats m_stats;
+};
@@ -0,0 +1,460 @@
+#include "cpu_voxelizer.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define VCT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+constexpr uint32_t BIN_SIZE = 16; // voxels per bin and axis, a multiple of VoxelGrid::BRICK_SIZE
+constexpr uint32_t AXIS_COUNT = 13; // 3 box normals, the triangle normal and 9 edge cross products
+constexpr uint32_t TRIANGLE_BATCH = 4096; // triangles per ParallelFor index while binning
+
+struct VoxelGridHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t resolution;
+    uint32_t padding;
+    float aabb[6];
+    uint64_t wordCount;
+};
+
+float MsSince(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start).count() / 1000.f;
+}
+
+// Triangle in voxel space, voxel (x, y, z) is the unit cube at (x, y, z)
+struct Triangle
+{
+    glm::vec3 v[3];
+};
+
+/* Separating axes of a triangle against any axis-aligned cube.
+ * The triangle projects to [triMin, triMax] on every axis and a cube of half size h centered at c to
+ * dot(axis, c) +- h * extent. voxelMin and voxelMax fold the voxel's h = 0.5 in, so a voxel overlaps
+ * iff voxelMin <= dot(axis, center) <= voxelMax on all axes.
+ */
+struct TriangleAxes
+{
+    alignas(16) float x[AXIS_COUNT];
+    alignas(16) float y[AXIS_COUNT];
+    alignas(16) float z[AXIS_COUNT];
+    alignas(16) float triMin[AXIS_COUNT];
+    alignas(16) float triMax[AXIS_COUNT];
+    alignas(16) float extent[AXIS_COUNT];
+    alignas(16) float voxelMin[AXIS_COUNT];
+    alignas(16) float voxelMax[AXIS_COUNT];
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+
+void SetupAxes(const Triangle& t, TriangleAxes& out)
+{
+    const glm::vec3 edges[3] = { t.v[1] - t.v[0], t.v[2] - t.v[1], t.v[0] - t.v[2] };
+    glm::vec3 axes[AXIS_COUNT] = { glm::vec3{ 1, 0, 0 }, glm::vec3{ 0, 1, 0 }, glm::vec3{ 0, 0, 1 },
+                                   glm::cross(edges[0], edges[1]) };
+    uint32_t count = 4;
+    for (const auto& edge : edges) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            axes[count++] = glm::cross(axes[i], edge);
+        }
+    }
+
+    for (uint32_t k = 0; k < AXIS_COUNT; ++k) {
+        const auto& axis = axes[k];
+        float d0 = glm::dot(axis, t.v[0]);
+        float d1 = glm::dot(axis, t.v[1]);
+        float d2 = glm::dot(axis, t.v[2]);
+        out.x[k] = axis.x;
+        out.y[k] = axis.y;
+        out.z[k] = axis.z;
+        out.triMin[k] = std::min({ d0, d1, d2 });
+        out.triMax[k] = std::max({ d0, d1, d2 });
+        out.extent[k] = std::abs(axis.x) + std::abs(axis.y) + std::abs(axis.z);
+        out.voxelMin[k] = out.triMin[k] - 0.5f * out.extent[k];
+        out.voxelMax[k] = out.triMax[k] + 0.5f * out.extent[k];
+    }
+    out.boundsMin = glm::min(t.v[0], glm::min(t.v[1], t.v[2]));
+    out.boundsMax = glm::max(t.v[0], glm::max(t.v[1], t.v[2]));
+}
+
+bool Overlaps(const TriangleAxes& a, const glm::vec3& center, float halfSize)
+{
+    for (uint32_t k = 0; k < AXIS_COUNT; ++k) {
+        float p = a.x[k] * center.x + a.y[k] * center.y + a.z[k] * center.z;
+        float r = halfSize * a.extent[k];
+        if (p + r < a.triMin[k] || p - r > a.triMax[k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Bit i is set if voxel (x + i, y, z) overlaps the triangle
+uint32_t OverlapMask4(const TriangleAxes& a, uint32_t x, uint32_t y, uint32_t z)
+{
+    const float cy = y + 0.5f;
+    const float cz = z + 0.5f;
+#if VCT_SSE2
+    const __m128 cx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (uint32_t k = 0; k < AXIS_COUNT; ++k) {
+        __m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.x[k]), cx), _mm_set1_ps(a.y[k] * cy + a.z[k] * cz));
+        inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(p, _mm_set1_ps(a.voxelMin[k])),
+                                               _mm_cmple_ps(p, _mm_set1_ps(a.voxelMax[k]))));
+        // Most axes separate every voxel of the row, stop at the first one that does
+        if (_mm_movemask_ps(inside) == 0) {
+            return 0;
+        }
+    }
+    return static_cast<uint32_t>(_mm_movemask_ps(inside));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (Overlaps(a, glm::vec3{ x + i + 0.5f, cy, cz }, 0.5f)) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+// Voxel range [first, last] of the triangle bounds clamped to the grid
+void VoxelBounds(const TriangleAxes& a, uint32_t resolution, glm::uvec3& first, glm::uvec3& last)
+{
+    const glm::vec3 maxVoxel{ static_cast<float>(resolution - 1) };
+    first = glm::uvec3{ glm::clamp(glm::floor(a.boundsMin), glm::vec3{ 0 }, maxVoxel) };
+    last = glm::uvec3{ glm::clamp(glm::floor(a.boundsMax), glm::vec3{ 0 }, maxVoxel) };
+}
+
+// Calls func(bin) for every bin the triangle overlaps
+template <typename Func>
+void ForEachBin(const TriangleAxes& a, uint32_t resolution, Func&& func)
+{
+    const uint32_t binsPerAxis = resolution / BIN_SIZE;
+    glm::uvec3 first, last;
+    VoxelBounds(a, resolution, first, last);
+    first /= BIN_SIZE;
+    last /= BIN_SIZE;
+    const bool single = first == last;
+    for (uint32_t z = first.z; z <= last.z; ++z) {
+        for (uint32_t y = first.y; y <= last.y; ++y) {
+            for (uint32_t x = first.x; x <= last.x; ++x) {
+                glm::vec3 center = (glm::vec3{ x, y, z } + 0.5f) * float{ BIN_SIZE };
+                if (single || Overlaps(a, center, 0.5f * BIN_SIZE)) {
+                    func((z * binsPerAxis + y) * binsPerAxis + x);
+                }
+            }
+        }
+    }
+}
+
+void VoxelizeTriangle(const TriangleAxes& a, const glm::uvec3& binFirst, VoxelGrid& grid)
+{
+    glm::uvec3 first, last;
+    VoxelBounds(a, grid.Resolution(), first, last);
+    first = glm::max(first, binFirst);
+    last = glm::min(last, binFirst + (BIN_SIZE - 1));
+    for (uint32_t z = first.z; z <= last.z; ++z) {
+        for (uint32_t y = first.y; y <= last.y; ++y) {
+            for (uint32_t x = first.x; x <= last.x; x += 4) {
+                uint32_t mask = OverlapMask4(a, x, y, z);
+                // The row may end inside the last group of 4
+                if (last.x - x < 3) {
+                    mask &= (1u << (last.x - x + 1)) - 1;
+                }
+                for (; mask != 0; mask &= mask - 1) {
+                    uint32_t i = 0;
+                    while (((mask >> i) & 1) == 0) {
+                        ++i;
+                    }
+                    grid.Set(x + i, y, z);
+                }
+            }
+        }
+    }
+}
+
+/* Marks everything reachable from the border of the grid without crossing an occupied voxel, one
+ * x span at a time, then sets every voxel that was neither reached nor occupied.
+ */
+uint64_t FillInterior(VoxelGrid& grid)
+{
+    PROFILE_FUNCTION();
+    const uint32_t res = grid.Resolution();
+    std::vector<uint64_t> exterior((size_t{ res } * res * res + 63) / 64);
+    auto index = [res](uint32_t x, uint32_t y, uint32_t z) { return (size_t{ z } * res + y) * res + x; };
+    auto isOpen = [&](uint32_t x, uint32_t y, uint32_t z) {
+        size_t i = index(x, y, z);
+        return ((exterior[i / 64] >> (i % 64)) & 1) == 0 && !grid.IsSet(x, y, z);
+    };
+
+    std::vector<glm::uvec3> stack;
+    auto fill = [&](uint32_t x, uint32_t y, uint32_t z) {
+        if (!isOpen(x, y, z)) {
+            return;
+        }
+        stack.push_back({ x, y, z });
+        while (!stack.empty()) {
+            glm::uvec3 seed = stack.back();
+            stack.pop_back();
+            if (!isOpen(seed.x, seed.y, seed.z)) {
+                continue;
+            }
+            uint32_t x0 = seed.x;
+            uint32_t x1 = seed.x;
+            while (x0 > 0 && isOpen(x0 - 1, seed.y, seed.z)) {
+                --x0;
+            }
+            while (x1 + 1 < res && isOpen(x1 + 1, seed.y, seed.z)) {
+                ++x1;
+            }
+            for (uint32_t i = x0; i <= x1; ++i) {
+                size_t bit = index(i, seed.y, seed.z);
+                exterior[bit / 64] |= uint64_t{ 1 } << (bit % 64);
+            }
+
+            // One seed per open run of the four neighbouring rows
+            const int32_t offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+            for (const auto& offset : offsets) {
+                uint32_t y = seed.y + offset[0];
+                uint32_t z = seed.z + offset[1];
+                if (y >= res || z >= res) {
+                    continue;
+                }
+                bool inRun = false;
+                for (uint32_t i = x0; i <= x1; ++i) {
+                    bool open = isOpen(i, y, z);
+                    if (open && !inRun) {
+                        stack.push_back({ i, y, z });
+                    }
+                    inRun = open;
+                }
+            }
+        }
+    };
+
+    for (uint32_t a = 0; a < res; ++a) {
+        for (uint32_t b = 0; b < res; ++b) {
+            fill(a, b, 0);
+            fill(a, b, res - 1);
+            fill(a, 0, b);
+            fill(a, res - 1, b);
+            fill(0, a, b);
+            fill(res - 1, a, b);
+        }
+    }
+
+    // A 64-bit word of the grid never spans two z slices, so the slices can be filled in parallel
+    std::atomic<uint64_t> interior{ 0 };
+    GetThreadPool().ParallelFor(res, [&](uint32_t z) {
+        uint64_t count = 0;
+        for (uint32_t y = 0; y < res; ++y) {
+            for (uint32_t x = 0; x < res; ++x) {
+                if (isOpen(x, y, z)) {
+                    grid.Set(x, y, z);
+                    ++count;
+                }
+            }
+        }
+        interior.fetch_add(count, std::memory_order_relaxed);
+    });
+    return interior.load();
+}
+
+}
+
+void VoxelGrid::Resize(uint32_t resolution)
+{
+    m_resolution = resolution;
+    m_bricksPerAxis = (resolution + BRICK_SIZE - 1) / BRICK_SIZE;
+    size_t words = size_t{ m_bricksPerAxis } * m_bricksPerAxis * m_bricksPerAxis * (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE / 64);
+    m_bits.assign(words, 0);
+}
+
+uint64_t VoxelGrid::CountOccupied() const
+{
+    uint64_t count = 0;
+    for (uint64_t word : m_bits) {
+        count += std::bitset<64>{ word }.count();
+    }
+    return count;
+}
+
+CpuVoxelizeStats VoxelizeSceneCpu(const SceneView& scene, const glm::vec3 aabb[2], uint32_t resolution,
+                                  bool fillInterior, VoxelGrid& outGrid)
+{
+    PROFILE_FUNCTION();
+    if (resolution == 0 || resolution % BIN_SIZE != 0) {
+        std::cerr << "CPU voxelizer resolution " << resolution << " is not a multiple of " << BIN_SIZE << '\n';
+        std::terminate();
+    }
+
+    CpuVoxelizeStats stats;
+    stats.resolution = resolution;
+    stats.triangles = scene.indexCount / 3;
+    outGrid.Resize(resolution);
+    auto& pool = GetThreadPool();
+
+    // Same mapping as the voxelize passes: the scene AABB is stretched over the grid on every axis
+    auto start = std::chrono::high_resolution_clock::now();
+    const glm::vec3 scale = float(resolution) / glm::max(aabb[1] - aabb[0], glm::vec3{ 1e-6f });
+    std::vector<Triangle> triangles(stats.triangles);
+    pool.ParallelFor(scene.meshCount, [&](uint32_t m) {
+        const auto& mesh = scene.meshes[m];
+        const uint32_t* indices = scene.indices + mesh.firstIndex;
+        Triangle* out = triangles.data() + mesh.firstIndex / 3;
+        for (uint32_t t = 0; t < mesh.indexCount / 3; ++t) {
+            for (uint32_t k = 0; k < 3; ++k) {
+                out[t].v[k] = (scene.vertices[mesh.firstVertex + indices[3 * t + k]].position - aabb[0]) * scale;
+            }
+        }
+    });
+
+    // Bin the triangles: count, prefix sum, then fill the lists of the bins they overlap
+    const uint32_t binsPerAxis = resolution / BIN_SIZE;
+    const uint32_t binCount = binsPerAxis * binsPerAxis * binsPerAxis;
+    const uint32_t batchCount = (stats.triangles + TRIANGLE_BATCH - 1) / TRIANGLE_BATCH;
+    auto forEachBatch = [&](auto&& func) {
+        pool.ParallelFor(batchCount, [&](uint32_t batch) {
+            TriangleAxes axes;
+            uint32_t end = std::min(stats.triangles, (batch + 1) * TRIANGLE_BATCH);
+            for (uint32_t t = batch * TRIANGLE_BATCH; t < end; ++t) {
+                SetupAxes(triangles[t], axes);
+                ForEachBin(axes, resolution, [&](uint32_t bin) { func(t, bin); });
+            }
+        });
+    };
+
+    std::vector<std::atomic<uint32_t>> binCursors(binCount);
+    forEachBatch([&](uint32_t, uint32_t bin) { binCursors[bin].fetch_add(1, std::memory_order_relaxed); });
+
+    std::vector<uint32_t> binOffsets(binCount + 1);
+    std::vector<uint32_t> nonEmptyBins;
+    for (uint32_t bin = 0; bin < binCount; ++bin) {
+        uint32_t count = binCursors[bin].load(std::memory_order_relaxed);
+        binCursors[bin].store(binOffsets[bin], std::memory_order_relaxed);
+        binOffsets[bin + 1] = binOffsets[bin] + count;
+        if (count > 0) {
+            nonEmptyBins.push_back(bin);
+        }
+    }
+    stats.binnedTriangles = binOffsets[binCount];
+
+    std::vector<uint32_t> binTriangles(binOffsets[binCount]);
+    forEachBatch([&](uint32_t t, uint32_t bin) {
+        binTriangles[binCursors[bin].fetch_add(1, std::memory_order_relaxed)] = t;
+    });
+    stats.binMs = MsSince(start);
+
+    // Bins own whole bricks of the grid, so the workers never write the same word. Bins are handed out
+    // one at a time, a worker stuck on a dense bin does not hold up the others.
+    start = std::chrono::high_resolution_clock::now();
+    pool.ParallelFor(static_cast<uint32_t>(nonEmptyBins.size()), [&](uint32_t i) {
+        uint32_t bin = nonEmptyBins[i];
+        glm::uvec3 binFirst = glm::uvec3{ bin % binsPerAxis, (bin / binsPerAxis) % binsPerAxis,
+                                          bin / (binsPerAxis * binsPerAxis) } * BIN_SIZE;
+        TriangleAxes axes;
+        for (uint32_t j = binOffsets[bin]; j < binOffsets[bin + 1]; ++j) {
+            SetupAxes(triangles[binTriangles[j]], axes);
+            VoxelizeTriangle(axes, binFirst, outGrid);
+        }
+    });
+    stats.voxelizeMs = MsSince(start);
+
+    if (fillInterior) {
+        start = std::chrono::high_resolution_clock::now();
+        stats.interiorVoxels = FillInterior(outGrid);
+        stats.fillMs = MsSince(start);
+    }
+    stats.occupiedVoxels = outGrid.CountOccupied();
+    return stats;
+}
+
+bool SaveVoxelGrid(const std::filesystem::path& path, const VoxelGrid& grid, const glm::vec3 aabb[2])
+{
+    PROFILE_FUNCTION();
+    VoxelGridHeader header{};
+    header.magic = VOXEL_GRID_MAGIC;
+    header.version = VOXEL_GRID_VERSION;
+    header.resolution = grid.Resolution();
+    for (uint32_t i = 0; i < 3; ++i) {
+        header.aabb[i] = aabb[0][i];
+        header.aabb[3 + i] = aabb[1][i];
+    }
+    header.wordCount = grid.Bits().size();
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Same temporary-then-rename scheme as the scene cache
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream ofs{ tmpPath, std::ios::binary | std::ios::trunc };
+        if (!ofs.is_open()) {
+            std::cerr << "Could not write voxel grid \"" << path.string() << "\"\n";
+            return false;
+        }
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char*>(grid.Bits().data()), grid.Bits().size() * sizeof(uint64_t));
+        if (!ofs.good()) {
+            std::cerr << "Could not write voxel grid \"" << path.string() << "\"\n";
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::cerr << "Could not write voxel grid \"" << path.string() << "\": " << ec.message() << '\n';
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool LoadVoxelGrid(const std::filesystem::path& path, VoxelGrid& outGrid, glm::vec3 outAabb[2])
+{
+    PROFILE_FUNCTION();
+    std::ifstream ifs{ path, std::ios::binary };
+    if (!ifs.is_open()) {
+        return false;
+    }
+    VoxelGridHeader header{};
+    ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!ifs.good() || header.magic != VOXEL_GRID_MAGIC || header.version != VOXEL_GRID_VERSION) {
+        std::cerr << "Voxel grid \"" << path.string() << "\" is not a valid version " << VOXEL_GRID_VERSION << " grid\n";
+        return false;
+    }
+
+    outGrid.Resize(header.resolution);
+    if (header.wordCount != outGrid.Bits().size()) {
+        std::cerr << "Voxel grid \"" << path.string() << "\" is truncated\n";
+        return false;
+    }
+    ifs.read(reinterpret_cast<char*>(outGrid.Bits().data()), outGrid.Bits().size() * sizeof(uint64_t));
+    if (!ifs.good()) {
+        std::cerr << "Voxel grid \"" << path.string() << "\" is truncated\n";
+        return false;
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+        outAabb[0][i] = header.aabb[i];
+        outAabb[1][i] = header.aabb[3 + i];
+    }
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "scene.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+/* CPU reference voxelizer
+ * Voxelizes a SceneView without a GPU, e.g. to check the GPU voxelizers or to bake grids on build
+ * servers. Follows the conventions of voxelize.frag: voxel (x, y, z) covers the same part of the scene
+ * AABB as image texel (x, y, z) and occupied voxels read as PackColor(vec4(1, 0, 0, 1)).
+ * Coverage is the exact triangle/box overlap of voxelize_triangles.comp, so it is conservative where
+ * the raster path samples voxel centers.
+ * Triangles are binned into BIN_SIZE^3 bins, the bins are voxelized in parallel on the thread pool, which
+ * hands them out one at a time to whichever worker is free. The voxel tests run 4 voxels at once with SSE2.
+ */
+
+constexpr uint32_t VOXEL_GRID_MAGIC = 0x56544356; // "VCTV"
+constexpr uint32_t VOXEL_GRID_VERSION = 1;
+
+// Color voxelize.frag writes, see include/color.glsl
+constexpr uint32_t VOXEL_COLOR = 0xff0000ff;
+
+// One bit per voxel in 8^3 bricks, so every bin owns whole words and threads never share one
+class VoxelGrid
+{
+public:
+    static constexpr uint32_t BRICK_SIZE = 8;
+
+    void Resize(uint32_t resolution); // clears
+    uint32_t Resolution() const { return m_resolution; }
+
+    bool IsSet(uint32_t x, uint32_t y, uint32_t z) const
+    {
+        size_t bit = BitIndex(x, y, z);
+        return (m_bits[bit / 64] >> (bit % 64)) & 1;
+    }
+    void Set(uint32_t x, uint32_t y, uint32_t z)
+    {
+        size_t bit = BitIndex(x, y, z);
+        m_bits[bit / 64] |= uint64_t{ 1 } << (bit % 64);
+    }
+
+    // Value the R32UI voxel image holds at the same coordinate
+    uint32_t Voxel(uint32_t x, uint32_t y, uint32_t z) const { return IsSet(x, y, z) ? VOXEL_COLOR : 0; }
+
+    uint64_t CountOccupied() const;
+
+    const std::vector<uint64_t>& Bits() const { return m_bits; }
+    std::vector<uint64_t>& Bits() { return m_bits; }
+
+private:
+    size_t BitIndex(uint32_t x, uint32_t y, uint32_t z) const
+    {
+        size_t brick = (size_t{ z / BRICK_SIZE } * m_bricksPerAxis + y / BRICK_SIZE) * m_bricksPerAxis + x / BRICK_SIZE;
+        uint32_t local = ((z % BRICK_SIZE) * BRICK_SIZE + y % BRICK_SIZE) * BRICK_SIZE + x % BRICK_SIZE;
+        return brick * (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE) + local;
+    }
+
+    uint32_t m_resolution{ 0 };
+    uint32_t m_bricksPerAxis{ 0 };
+    std::vector<uint64_t> m_bits;
+};
+
+struct CpuVoxelizeStats
+{
+    uint32_t resolution{ 0 };
+    uint32_t triangles{ 0 };
+    uint64_t binnedTriangles{ 0 }; // triangle/bin pairs
+    uint64_t occupiedVoxels{ 0 };
+    uint64_t interiorVoxels{ 0 };
+    float binMs{ 0 };
+    float voxelizeMs{ 0 };
+    float fillMs{ 0 };
+    float TotalMs() const { return binMs + voxelizeMs + fillMs; }
+    double TrianglesPerSecond() const { return triangles / (TotalMs() / 1000.0); }
+    double VoxelsPerSecond() const { return occupiedVoxels / (TotalMs() / 1000.0); }
+};
+
+// resolution must be a multiple of 16. fillInterior also sets every empty voxel that cannot be reached
+// from the border of the grid, which only encloses something for closed meshes.
+CpuVoxelizeStats VoxelizeSceneCpu(const SceneView& scene, const glm::vec3 aabb[2], uint32_t resolution,
+                                  bool fillInterior, VoxelGrid& outGrid);
+
+// Baked grid (.vctvox): header, scene AABB and the bits as stored in VoxelGrid
+bool SaveVoxelGrid(const std::filesystem::path& path, const VoxelGrid& grid, const glm::vec3 aabb[2]);
+bool LoadVoxelGrid(const std::filesystem::path& path, VoxelGrid& outGrid, glm::vec3 outAabb[2]);
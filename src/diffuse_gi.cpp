@@ -0,0 +1,194 @@
+#include "diffuse_gi.h"
+#include "profiler.h"
+
+#include <imgui.h>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <exception>
+#include <iostream>
+
+namespace
+{
+
+constexpr const char* GI_TRACE_CS_PATH = "resources/shaders/gi_trace.comp";
+constexpr const char* GI_UPSAMPLE_CS_PATH = "resources/shaders/gi_upsample.comp";
+constexpr const char* QUAD_VS_PATH = "resources/shaders/quad.vert";
+constexpr const char* GI_COMPOSITE_FS_PATH = "resources/shaders/gi_composite.frag";
+
+// Radiance of cones that leave the volume without being fully occluded
+constexpr glm::vec3 SKY_COLOR{ 0.75f, 0.85f, 1.0f };
+
+// GPU timer names, one trace timer per quality so that switching does not mix their histories
+constexpr const char* TRACE_TIMERS[DiffuseGI::QUALITY_COUNT] = { "GI trace Low", "GI trace Medium", "GI trace High" };
+constexpr const char* UPSAMPLE_TIMER = "GI upsample";
+constexpr const char* COMPOSITE_TIMER = "GI composite";
+
+constexpr double PIXELS_1080P = 1920.0 * 1080.0;
+
+GLuint CreateTarget(GLenum format, uint32_t width, uint32_t height, GLenum filter)
+{
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, format, width, height);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, filter);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, filter);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+uint32_t GroupCount(uint32_t size)
+{
+    return (size + DiffuseGI::GROUP_SIZE - 1) / DiffuseGI::GROUP_SIZE;
+}
+
+}
+
+void DiffuseGI::SubmitShaders(ShaderCompiler& compiler)
+{
+    for (uint32_t quality = 0; quality < QUALITY_COUNT; ++quality) {
+        const auto& preset = QUALITIES[quality];
+        compiler.Submit(m_tracePrograms[quality], "gi_trace",
+                        { { GI_TRACE_CS_PATH, GL_COMPUTE_SHADER } }, false,
+                        { MakeDefine("CONE_COUNT", preset.coneCount), MakeDefine("STEP_SIZE", preset.stepSize),
+                          MakeDefine("MAX_DISTANCE", preset.maxDistance) });
+    }
+    compiler.Submit(m_upsampleProgram, "gi_upsample", { { GI_UPSAMPLE_CS_PATH, GL_COMPUTE_SHADER } }, false);
+    compiler.Submit(m_compositeProgram, "gi_composite", {
+        { QUAD_VS_PATH, GL_VERTEX_SHADER },
+        { GI_COMPOSITE_FS_PATH, GL_FRAGMENT_SHADER } }, false);
+}
+
+bool DiffuseGI::IsReady(const ShaderCompiler& compiler, uint32_t quality) const
+{
+    return compiler.IsReady(m_tracePrograms[quality]) && compiler.IsReady(m_upsampleProgram) &&
+           compiler.IsReady(m_compositeProgram);
+}
+
+void DiffuseGI::Resize(uint32_t width, uint32_t height, uint32_t downscale)
+{
+    if (IsCreated() && width == m_width && height == m_height && downscale == m_downscale) {
+        return;
+    }
+    Destroy();
+    m_width = width;
+    m_height = height;
+    m_downscale = downscale;
+
+    // The upsample reads depth and normal per texel, only the GI itself is filtered
+    m_albedoTex = CreateTarget(GL_RGBA8, width, height, GL_NEAREST);
+    m_normalTex = CreateTarget(GL_RGBA16F, width, height, GL_NEAREST);
+    m_depthTex = CreateTarget(GL_DEPTH_COMPONENT32F, width, height, GL_NEAREST);
+    m_giTex = CreateTarget(GL_RGBA16F, (width + downscale - 1) / downscale, (height + downscale - 1) / downscale, GL_LINEAR);
+    m_upsampledTex = CreateTarget(GL_RGBA16F, width, height, GL_LINEAR);
+
+    glCreateFramebuffers(1, &m_framebuffer);
+    glNamedFramebufferTexture(m_framebuffer, GL_COLOR_ATTACHMENT0, m_albedoTex, 0);
+    glNamedFramebufferTexture(m_framebuffer, GL_COLOR_ATTACHMENT1, m_normalTex, 0);
+    glNamedFramebufferTexture(m_framebuffer, GL_DEPTH_ATTACHMENT, m_depthTex, 0);
+    const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glNamedFramebufferDrawBuffers(m_framebuffer, 2, drawBuffers);
+    if (glCheckNamedFramebufferStatus(m_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Incomplete G-buffer of " << width << "x" << height << '\n';
+        std::terminate();
+    }
+}
+
+void DiffuseGI::Destroy()
+{
+    glDeleteFramebuffers(1, &m_framebuffer);
+    const GLuint textures[] = { m_albedoTex, m_normalTex, m_depthTex, m_giTex, m_upsampledTex };
+    glDeleteTextures(5, textures);
+    m_framebuffer = 0;
+    m_albedoTex = m_normalTex = m_depthTex = m_giTex = m_upsampledTex = 0;
+    m_width = m_height = m_downscale = 0;
+}
+
+void DiffuseGI::BeginGBuffer()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_width, m_height);
+    const float zero[4] = { 0, 0, 0, 0 };
+    const float one = 1;
+    glClearNamedFramebufferfv(m_framebuffer, GL_COLOR, 0, zero);
+    glClearNamedFramebufferfv(m_framebuffer, GL_COLOR, 1, zero);
+    glClearNamedFramebufferfv(m_framebuffer, GL_DEPTH, 0, &one);
+}
+
+void DiffuseGI::Apply(const ShaderCompiler& compiler, GpuTimers& timers, const glm::mat4& viewProj, uint32_t quality,
+                      float strength, bool indirectOnly, GLuint genericDrawVao)
+{
+    PROFILE_FUNCTION();
+    glBindTextureUnit(GI_GBUFFER_TEXTURE_UNIT, m_albedoTex);
+    glBindTextureUnit(GI_GBUFFER_TEXTURE_UNIT + 1, m_normalTex);
+    glBindTextureUnit(GI_GBUFFER_TEXTURE_UNIT + 2, m_depthTex);
+    {
+        ScopedGpuTimer gpuTimer{ timers, TRACE_TIMERS[quality] };
+        GLuint program = m_tracePrograms[quality];
+        const auto& reflection = compiler.Reflection(program);
+        glUseProgram(program);
+        glProgramUniformMatrix4fv(program, reflection.Location("u_invViewProj"), 1, GL_FALSE,
+                                  glm::value_ptr(glm::inverse(viewProj)));
+        glProgramUniform1i(program, reflection.Location("u_downscale"), m_downscale);
+        glProgramUniform3fv(program, reflection.Location("u_skyColor"), 1, glm::value_ptr(SKY_COLOR));
+        glBindImageTexture(GI_IMAGE_BINDING, m_giTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        const uint32_t width = (m_width + m_downscale - 1) / m_downscale;
+        const uint32_t height = (m_height + m_downscale - 1) / m_downscale;
+        glDispatchCompute(GroupCount(width), GroupCount(height), 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    {
+        ScopedGpuTimer gpuTimer{ timers, UPSAMPLE_TIMER };
+        glUseProgram(m_upsampleProgram);
+        glProgramUniform1i(m_upsampleProgram, compiler.Reflection(m_upsampleProgram).Location("u_downscale"), m_downscale);
+        glBindTextureUnit(GI_TEXTURE_UNIT, m_giTex);
+        glBindImageTexture(GI_IMAGE_BINDING, m_upsampledTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute(GroupCount(m_width), GroupCount(m_height), 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    {
+        ScopedGpuTimer gpuTimer{ timers, COMPOSITE_TIMER };
+        const auto& reflection = compiler.Reflection(m_compositeProgram);
+        glUseProgram(m_compositeProgram);
+        glProgramUniform1f(m_compositeProgram, reflection.Location("u_strength"), strength);
+        glProgramUniform1i(m_compositeProgram, reflection.Location("u_indirectOnly"), indirectOnly);
+        glBindTextureUnit(GI_TEXTURE_UNIT + 1, m_upsampledTex);
+        // Writes every pixel with the scene depth, the background keeps the far plane. The G-buffer may be
+        // drawn in wireframe, the quad never is.
+        GLint polygonMode[2];
+        glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_ALWAYS);
+        glBindVertexArray(genericDrawVao);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glDepthFunc(GL_LESS);
+        glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+    }
+}
+
+float DiffuseGI::Cost1080pMs(const GpuTimers& timers, uint32_t quality) const
+{
+    const double pixels = double(m_width) * m_height;
+    if (pixels == 0) {
+        return 0;
+    }
+    // Every pass is bound by its pixel count
+    const float ms = timers.AverageMs(TRACE_TIMERS[quality]) + timers.AverageMs(UPSAMPLE_TIMER) + 
+                     timers.AverageMs(COMPOSITE_TIMER);
+    return static_cast<float>(ms * PIXELS_1080P / pixels);
+}
+
+void DiffuseGI::Draw(const GpuTimers& timers, uint32_t quality) const
+{
+    const uint32_t traceWidth = (m_width + m_downscale - 1) / m_downscale;
+    const uint32_t traceHeight = (m_height + m_downscale - 1) / m_downscale;
+    ImGui::Text("G-buffer: %ux%u, traced at %ux%u", m_width, m_height, traceWidth, traceHeight);
+    ImGui::Text("Trace %.2f ms, upsample %.2f ms, composite %.2f ms", timers.AverageMs(TRACE_TIMERS[quality]),
+                timers.AverageMs(UPSAMPLE_TIMER), timers.AverageMs(COMPOSITE_TIMER));
+    if (m_width != 1920 || m_height != 1080) {
+        ImGui::Text("1080p cost is scaled from %ux%u, render at 1080p to measure it", m_width, m_height);
+    }
+}
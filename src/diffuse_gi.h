@@ -0,0 +1,88 @@
+#pragma once
+
+#include "gpu_timer.h"
+#include "shader_compiler.h"
+#include "voxel_mipmap.h"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// G-buffer albedo, normal and depth take the units from GI_GBUFFER_TEXTURE_UNIT, after the voxel mip volume
+constexpr GLuint GI_GBUFFER_TEXTURE_UNIT = 9;
+constexpr GLuint GI_TEXTURE_UNIT = 12; // low resolution GI, then the upsampled one at GI_TEXTURE_UNIT + 1
+constexpr GLuint GI_IMAGE_BINDING = 4; // after the voxel mip levels
+
+// Compile time parameters of one trace permutation
+struct DiffuseGIQuality
+{
+    const char* name;
+    uint32_t coneCount;
+    float stepSize;    // in cone diameters
+    float maxDistance; // in voxels of mip level 0
+};
+
+/* Diffuse global illumination by voxel cone tracing
+ * The mesh pass renders albedo, normal and depth into a G-buffer. gi_trace.comp runs at 1/downscale of
+ * its resolution and traces the cones of the selected quality through the voxel mip volume, see
+ * include/cone_trace.glsl; cone count, step and distance are compile time constants of its permutations.
+ * gi_upsample.comp brings the result back to full resolution with weights that reject low resolution
+ * samples across depth or normal discontinuities, gi_composite.frag lights the albedo with it into the
+ * bound framebuffer and writes the G-buffer depth so later passes depth test against the scene.
+ * The G-buffer may have a fixed size, e.g. 1080p to measure the cost independently of the window.
+ */
+class DiffuseGI
+{
+public:
+    static constexpr uint32_t QUALITY_COUNT = 3;
+    static constexpr DiffuseGIQuality QUALITIES[QUALITY_COUNT] = {
+        { "Low", 6, 1.0f, 48.0f },
+        { "Medium", 9, 0.75f, 96.0f },
+        { "High", 16, 0.5f, 160.0f },
+    };
+    static constexpr uint32_t GROUP_SIZE = 8; // of both compute passes, per axis
+
+    void SubmitShaders(ShaderCompiler& compiler);
+    bool IsReady(const ShaderCompiler& compiler, uint32_t quality) const;
+
+    // Recreates the targets when the size or the downscale changed
+    void Resize(uint32_t width, uint32_t height, uint32_t downscale);
+    void Destroy();
+    bool IsCreated() const { return m_framebuffer != 0; }
+
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    uint32_t Downscale() const { return m_downscale; }
+
+    // Binds and clears the G-buffer for the mesh pass, albedo goes to location 0 and the normal to location 1
+    void BeginGBuffer();
+
+    /*
+     * Traces the volume bound at VOXEL_MIP_TEXTURE_UNIT, upsamples and composites into the framebuffer and
+     * viewport bound by the caller. indirectOnly shows the GI without the albedo.
+     */
+    void Apply(const ShaderCompiler& compiler, GpuTimers& timers, const glm::mat4& viewProj, uint32_t quality,
+               float strength, bool indirectOnly, GLuint genericDrawVao);
+
+    // GPU time of all passes averaged over the timer history, scaled by the pixel count unless rendered at 1080p
+    float Cost1080pMs(const GpuTimers& timers, uint32_t quality) const;
+
+    // Resolutions and the time of every pass
+    void Draw(const GpuTimers& timers, uint32_t quality) const;
+
+private:
+    GLuint m_tracePrograms[QUALITY_COUNT]{};
+    GLuint m_upsampleProgram{ 0 };
+    GLuint m_compositeProgram{ 0 };
+
+    uint32_t m_width{ 0 };
+    uint32_t m_height{ 0 };
+    uint32_t m_downscale{ 0 };
+    GLuint m_framebuffer{ 0 };
+    GLuint m_albedoTex{ 0 };
+    GLuint m_normalTex{ 0 };
+    GLuint m_depthTex{ 0 };
+    GLuint m_giTex{ 0 };         // RGBA16F at 1/downscale, indirect radiance and occlusion
+    GLuint m_upsampledTex{ 0 };  // RGBA16F at full resolution
+};
@@ -0,0 +1,133 @@
+#include "file_watcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+bool FileWatcher::Start(const std::filesystem::path& directory)
+{
+    Stop();
+    std::error_code ec;
+    if (!std::filesystem::is_directory(directory, ec)) {
+        std::cerr << "Cannot watch \"" << directory.string() << "\", not a directory\n";
+        return false;
+    }
+    m_directory = directory.lexically_normal();
+
+#ifdef __linux__
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify >= 0) {
+        // inotify is not recursive, every subdirectory gets its own watch
+        std::vector<std::filesystem::path> directories{ m_directory };
+        for (auto it = std::filesystem::recursive_directory_iterator(m_directory, ec);
+             it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_directory(ec)) {
+                directories.push_back(it->path().lexically_normal());
+            }
+        }
+        for (const auto& dir : directories) {
+            // Editors either rewrite the file in place or move a temporary over it
+            int wd = inotify_add_watch(m_inotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+            if (wd >= 0) {
+                m_watches[wd] = dir;
+            }
+        }
+        std::cout << "Watching \"" << m_directory.string() << "\" with inotify\n";
+        return true;
+    }
+    std::cerr << "inotify_init1 failed, falling back to polling modification times\n";
+#endif
+
+    ScanModificationTimes();
+    m_changed.clear(); // the first scan only records the current state
+    std::cout << "Watching \"" << m_directory.string() << "\" by polling\n";
+    return true;
+}
+
+void FileWatcher::Stop()
+{
+#ifdef __linux__
+    if (m_inotify >= 0) {
+        close(m_inotify);
+    }
+#endif
+    m_inotify = -1;
+    m_watches.clear();
+    m_modificationTimes.clear();
+    m_changed.clear();
+}
+
+std::vector<std::filesystem::path> FileWatcher::Poll()
+{
+    if (m_directory.empty()) {
+        return {};
+    }
+
+#ifdef __linux__
+    if (m_inotify >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t size;
+        while ((size = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < size;) {
+                auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                auto it = m_watches.find(event->wd);
+                if (it != m_watches.end() && event->len > 0 && !(event->mask & IN_ISDIR)) {
+                    Changed(it->second / event->name);
+                }
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+    else
+#endif
+    if (Clock::now() - m_lastScan >= POLL_INTERVAL) {
+        ScanModificationTimes();
+    }
+
+    if (m_changed.empty() || Clock::now() - m_lastChange < QUIET_TIME) {
+        return {};
+    }
+    auto changed = std::move(m_changed);
+    m_changed.clear();
+    return changed;
+}
+
+void FileWatcher::Changed(const std::filesystem::path& path)
+{
+    auto normalized = path.lexically_normal();
+    if (std::find(m_changed.begin(), m_changed.end(), normalized) == m_changed.end()) {
+        m_changed.push_back(std::move(normalized));
+    }
+    m_lastChange = Clock::now();
+}
+
+void FileWatcher::ScanModificationTimes()
+{
+    m_lastScan = Clock::now();
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(m_directory, ec);
+         it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file(ec)) {
+            continue;
+        }
+        auto time = it->last_write_time(ec);
+        auto path = it->path().lexically_normal();
+        auto [entry, inserted] = m_modificationTimes.try_emplace(path, time);
+        if (!inserted && entry->second != time) {
+            entry->second = time;
+            Changed(path);
+        }
+        else if (inserted) {
+            Changed(path);
+        }
+    }
+}
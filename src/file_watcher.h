@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <vector>
+
+/* Reports files modified under a directory tree
+ * Uses inotify on Linux and polls modification times elsewhere. Changes are held back until the
+ * tree has been quiet for QUIET_TIME, editors tend to write a file several times per save.
+ * Paths are returned lexically normalized and relative the same way as the watched directory.
+ */
+class FileWatcher
+{
+public:
+    static constexpr auto QUIET_TIME = std::chrono::milliseconds(100);
+    static constexpr auto POLL_INTERVAL = std::chrono::milliseconds(500); // modification time fallback only
+
+    FileWatcher() = default;
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool Start(const std::filesystem::path& directory);
+    void Stop();
+
+    // Non-blocking, call once per frame
+    std::vector<std::filesystem::path> Poll();
+
+    bool UsesInotify() const { return m_inotify >= 0; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void Changed(const std::filesystem::path& path);
+    void ScanModificationTimes();
+
+    std::filesystem::path m_directory;
+    int m_inotify{ -1 };
+    std::map<int, std::filesystem::path> m_watches; // inotify watch descriptor -> directory
+    std::map<std::filesystem::path, std::filesystem::file_time_type> m_modificationTimes;
+    Clock::time_point m_lastScan;
+
+    std::vector<std::filesystem::path> m_changed;
+    Clock::time_point m_lastChange;
+};
@@ -0,0 +1,218 @@
+#include "gpu_timer.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+constexpr const char* GPU_TIMINGS_PATH = "gpu_timings.csv";
+
+void GpuTimers::Create()
+{
+    for (auto& frame : m_frames) {
+        frame = Frame{};
+    }
+    m_frameIndex = 0;
+}
+
+void GpuTimers::Destroy()
+{
+    for (auto& frame : m_frames) {
+        if (!frame.queryPool.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(frame.queryPool.size()), frame.queryPool.data());
+        }
+        frame = Frame{};
+    }
+}
+
+void GpuTimers::BeginFrame()
+{
+    ++m_frameIndex;
+    auto& frame = m_frames[m_frameIndex % FRAME_LATENCY];
+    if (!frame.timers.empty()) {
+        Resolve(frame);
+    }
+    frame.timers.clear();
+    frame.lastEndQuery = 0;
+    frame.index = m_frameIndex;
+}
+
+uint32_t GpuTimers::Begin(const char* name)
+{
+    auto& frame = m_frames[m_frameIndex % FRAME_LATENCY];
+    size_t first = frame.timers.size() * 2;
+    if (frame.queryPool.size() < first + 2) {
+        frame.queryPool.resize(first + 2);
+        glCreateQueries(GL_TIMESTAMP, 2, frame.queryPool.data() + first);
+    }
+
+    Timer timer{ FindPass(name), { frame.queryPool[first], frame.queryPool[first + 1] } };
+    glQueryCounter(timer.queries[0], GL_TIMESTAMP);
+    frame.timers.push_back(timer);
+    return static_cast<uint32_t>(frame.timers.size() - 1);
+}
+
+void GpuTimers::End(uint32_t timer)
+{
+    auto& frame = m_frames[m_frameIndex % FRAME_LATENCY];
+    glQueryCounter(frame.timers[timer].queries[1], GL_TIMESTAMP);
+    frame.lastEndQuery = frame.timers[timer].queries[1];
+}
+
+void GpuTimers::StartCapture(uint32_t frameCount, const std::filesystem::path& path)
+{
+    m_captureRemaining = frameCount;
+    m_capturePath = path;
+    m_captureRows.clear();
+    m_captureRows.reserve(frameCount);
+}
+
+uint32_t GpuTimers::FindPass(const char* name)
+{
+    for (uint32_t i = 0; i < m_passes.size(); ++i) {
+        if (m_passes[i].name == name || std::strcmp(m_passes[i].name, name) == 0) {
+            return i;
+        }
+    }
+    m_passes.push_back({ name });
+    return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+void GpuTimers::Resolve(Frame& frame)
+{
+    // Timestamps complete in submission order, the last one written being ready means all of them are.
+    // That is the end of the outermost pass when passes nest, not the end of the last one begun.
+    GLuint available = 0;
+    if (frame.lastEndQuery != 0) {
+        glGetQueryObjectuiv(frame.lastEndQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    }
+    if (!available) {
+        ++m_droppedFrames;
+        return;
+    }
+
+    std::map<uint32_t, float> passMs;
+    for (const auto& timer : frame.timers) {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(timer.queries[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(timer.queries[1], GL_QUERY_RESULT, &end);
+        passMs[timer.pass] += (end - begin) / 1e6f;
+    }
+
+    for (const auto& [pass, ms] : passMs) {
+        auto& p = m_passes[pass];
+        p.history[p.historyCount % HISTORY] = ms;
+        ++p.historyCount;
+    }
+
+    if (m_captureRemaining > 0) {
+        m_captureRows.push_back(std::move(passMs));
+        if (--m_captureRemaining == 0) {
+            WriteCapture();
+        }
+    }
+}
+
+void GpuTimers::WriteCapture()
+{
+    std::ofstream ofs{ m_capturePath };
+    if (!ofs.is_open()) {
+        std::cerr << "Could not write GPU timings to " << m_capturePath << '\n';
+        return;
+    }
+
+    ofs << "frame";
+    for (const auto& pass : m_passes) {
+        ofs << ',' << pass.name;
+    }
+    ofs << '\n';
+    for (size_t i = 0; i < m_captureRows.size(); ++i) {
+        ofs << i;
+        for (uint32_t pass = 0; pass < m_passes.size(); ++pass) {
+            ofs << ',';
+            auto it = m_captureRows[i].find(pass);
+            if (it != m_captureRows[i].end()) {
+                ofs << it->second;
+            }
+        }
+        ofs << '\n';
+    }
+    std::cout << "GPU timings of " << m_captureRows.size() << " frames written to " << m_capturePath << '\n';
+    m_captureRows.clear();
+}
+
+float GpuTimers::AverageMs(const char* name) const
+{
+    for (const auto& pass : m_passes) {
+        if (pass.name == name || std::strcmp(pass.name, name) == 0) {
+            uint32_t count = std::min(pass.historyCount, HISTORY);
+            float sum = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                sum += pass.history[i];
+            }
+            return count > 0 ? sum / count : 0;
+        }
+    }
+    return 0;
+}
+
+void GpuTimers::DrawTable()
+{
+    constexpr int flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("GPU passes", 5, flags)) {
+        ImGui::TableSetupColumn("Pass");
+        ImGui::TableSetupColumn("Min ms");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("P95 ms");
+        ImGui::TableSetupColumn("Max ms");
+        ImGui::TableHeadersRow();
+
+        std::vector<float> samples;
+        float totalAvg = 0;
+        for (const auto& pass : m_passes) {
+            uint32_t count = std::min(pass.historyCount, HISTORY);
+            if (count == 0) {
+                continue;
+            }
+            samples.assign(pass.history, pass.history + count);
+            float sum = 0;
+            for (float sample : samples) {
+                sum += sample;
+            }
+            auto minmax = std::minmax_element(samples.begin(), samples.end());
+            float minMs = *minmax.first, maxMs = *minmax.second;
+            auto p95 = samples.begin() + (count - 1) * 95 / 100;
+            std::nth_element(samples.begin(), p95, samples.end());
+            totalAvg += sum / count;
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", pass.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", minMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", sum / count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", *p95);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", maxMs);
+        }
+        ImGui::EndTable();
+        ImGui::Text("Sum of averages: %.3f ms over the last %u frames, %llu dropped", totalAvg, HISTORY,
+                    static_cast<unsigned long long>(m_droppedFrames));
+    }
+
+    static int captureFrames = 1000;
+    if (IsCapturing()) {
+        ImGui::Text("Capturing, %u frames left", m_captureRemaining);
+    }
+    else {
+        ImGui::InputInt("Frames", &captureFrames);
+        captureFrames = std::max(captureFrames, 1);
+        if (ImGui::Button("Capture CSV")) {
+            StartCapture(static_cast<uint32_t>(captureFrames), GPU_TIMINGS_PATH);
+        }
+    }
+}
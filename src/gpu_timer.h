@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+/* GPU time of render passes
+ * Every Begin/End pair writes two GL_TIMESTAMP queries, so passes may nest. Queries are kept per frame
+ * in FRAME_LATENCY slots and a slot is only read back when it comes around again, by which time the GPU
+ * has normally finished it; results that are still not available are dropped rather than waited for.
+ * Must be used from the thread owning the GL context.
+ */
+class GpuTimers
+{
+public:
+    static constexpr uint32_t FRAME_LATENCY = 3;
+    static constexpr uint32_t HISTORY = 240;
+
+    void Create();
+    void Destroy();
+
+    // Resolve the slot about to be reused, call once at the start of every frame
+    void BeginFrame();
+
+    // name must have static storage duration, a pass timed several times per frame is summed
+    uint32_t Begin(const char* name);
+    void End(uint32_t timer);
+
+    // Record the next frameCount resolved frames and write them as CSV, one row per frame
+    void StartCapture(uint32_t frameCount, const std::filesystem::path& path);
+    bool IsCapturing() const { return m_captureRemaining > 0; }
+
+    // Rolling average of a pass over its history, 0 until it has been resolved once
+    float AverageMs(const char* name) const;
+
+    // Table of the rolling min/avg/p95/max of each pass plus capture controls
+    void DrawTable();
+
+private:
+    struct Pass
+    {
+        const char* name;
+        float history[HISTORY]{ 0 };
+        uint32_t historyCount{ 0 };
+    };
+
+    struct Timer
+    {
+        uint32_t pass;
+        GLuint queries[2];
+    };
+
+    struct Frame
+    {
+        std::vector<GLuint> queryPool; // grows on demand, two per timer
+        std::vector<Timer> timers;
+        GLuint lastEndQuery{ 0 }; // written by the latest End(), with nesting not the one of timers.back()
+        uint64_t index{ 0 };
+    };
+
+    uint32_t FindPass(const char* name);
+    void Resolve(Frame& frame);
+    void WriteCapture();
+
+    Frame m_frames[FRAME_LATENCY];
+    uint64_t m_frameIndex{ 0 };
+    std::vector<Pass> m_passes;
+    uint64_t m_droppedFrames{ 0 };
+
+    // CSV capture
+    uint32_t m_captureRemaining{ 0 };
+    std::filesystem::path m_capturePath;
+    std::vector<std::map<uint32_t, float>> m_captureRows;
+};
+
+// Times the enclosing scope as one pass
+class ScopedGpuTimer
+{
+public:
+    ScopedGpuTimer(GpuTimers& timers, const char* name)
+        : m_timers(timers), m_timer(timers.Begin(name))
+    {
+    }
+
+    ~ScopedGpuTimer() { m_timers.End(m_timer); }
+
+    ScopedGpuTimer(const ScopedGpuTimer&) = delete;
+    ScopedGpuTimer& operator=(const ScopedGpuTimer&) = delete;
+
+private:
+    GpuTimers& m_timers;
+    uint32_t m_timer;
+};
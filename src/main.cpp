@@ -1,4 +1,25 @@
 #include "utils.h"
+#include "axis_streams.h"
+#include "bc_encoder.h"
+#include "compute_voxelizer.h"
+#include "cpu_voxelizer.h"
+#include "diffuse_gi.h"
+#include "file_watcher.h"
+#include "gpu_timer.h"
+#include "mapped_file.h"
+#include "scene.h"
+#include "scene_cache.h"
+#include "shader_compiler.h"
+#include "sparse_voxel_octree.h"
+#include "mesh_optimizer.h"
+#include "meshlet.h"
+#include "profiler.h"
+#include "texture_loader.h"
+#include "thread_pool.h"
+#include "upload_ring.h"
+#include "vertex_packing.h"
+#include "voxel_mipmap.h"
+#include "voxel_stats.h"
 
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
@@ -14,24 +35,29 @@
 #include <glm/gtx/string_cast.hpp>
 #undef GLM_ENABLE_EXPERIMENTAL
 
-#include <assimp/Importer.hpp>
 #include <assimp/scene.h>
-#include <assimp/postprocess.h>
-#include <assimp/mesh.h>
-
-#include <stb_image.h>
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <limits>
+#include <memory>
 #include <sstream>
 #include <chrono>
 
 // Window dimensions
 constexpr GLuint WIDTH = 1280, HEIGHT = 720;
 constexpr const char* MODEL_PATH = "resources/models/crytek-sponza";
+constexpr const char* CACHE_PATH = "cache";
+constexpr const char* TRACE_PATH = "vct_trace.json";
+constexpr const char* SHADER_DIR = "resources/shaders"; // watched for hot reload
 
 struct Material
 {
@@ -40,25 +66,24 @@ struct Material
     bool twoSided{ false };
 };
 
+// A range of the shared scene buffers
 struct Mesh
 {
-    GLuint vao{ 0 };
-
-    // buffers
-    GLuint vbo{ 0 };
-    GLuint ebo{ 0 };
-
-    uint32_t vertexCount{ 0 };
+    uint32_t firstIndex{ 0 };
+    uint32_t indexCount{ 0 };
+    uint32_t baseVertex{ 0 };
 
     // textures
     uint32_t materialIndex{ 0 };
-};
 
-struct Vertex 
-{
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 texCoord;
+    // range of g_meshlets
+    uint32_t firstMeshlet{ 0 };
+    uint32_t meshletCount{ 0 };
+
+    // packed layout
+    uint32_t packedIndexOffset{ 0 }; // in bytes
+    GLenum packedIndexType{ GL_UNSIGNED_INT };
+    glm::vec3 aabb[2]{};
 };
 
 struct Camera
@@ -66,6 +91,17 @@ struct Camera
     glm::mat4 matrix;
 };
 
+// std140 layout of the FrameUniforms block in include/frame_uniforms.glsl
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 viewProj;
+    glm::vec4 sceneAABB[2];
+    glm::vec4 cameraPosition;
+};
+static_assert(sizeof(FrameUniforms) == 3 * 64 + 3 * 16);
+
 struct Settings
 {
     bool showVoxels{ false };
@@ -73,6 +109,98 @@ struct Settings
     bool showWireframe{ false };
     bool showMesh{ true };
     bool showAxes{ false };
+    bool packedVertices{ false };
+    bool meshletCulling{ true };
+    bool voxelStats{ false };
+    bool voxelizeEveryFrame{ false }; // for benchmarking, the volume is otherwise only rebuilt when stale
+    bool sparseVoxels{ false };
+    bool computeVoxelizer{ false }; // dense volume only, the octree is built from the raster fragment list
+    bool gsVoxelizer{ false }; // benchmark baseline, the raster voxelizer otherwise draws axis streams without a GS
+    int mipLevelsPerDispatch{ 3 };
+    bool refilterDirtyRegion{ true }; // only the mips above voxels that changed, or all of them
+    int shownVoxelLevel{ -1 }; // -1 shows the R32UI volume, otherwise a level of the mip volume
+    int shownVoxelDirection{ 0 };
+    bool diffuseGI{ false }; // dense volume only, cone traced through its mip volume
+    int giQuality{ 1 }; // index of DiffuseGI::QUALITIES
+    int giDownscale{ 2 }; // trace resolution, 2 or 4
+    float giStrength{ 1.f };
+    bool giIndirectOnly{ false };
+    bool giAt1080p{ false }; // fixed 1920x1080 G-buffer, so timings do not depend on the window
+};
+
+// Everything the voxel volume depends on, it is rebuilt when any of it changes
+struct VoxelizationInputs
+{
+    uint32_t meshCount{ 0 };
+    glm::vec3 aabb[2]{};
+    uint32_t resolution{ 0 };
+    bool packedVertices{ false };
+    GLuint programs[2]{ 0 }; // of the voxelizer used, a hot reload changes them
+
+    bool operator==(const VoxelizationInputs& other) const
+    {
+        return meshCount == other.meshCount && aabb[0] == other.aabb[0] && aabb[1] == other.aabb[1] &&
+               resolution == other.resolution && packedVertices == other.packedVertices &&
+               programs[0] == other.programs[0] && programs[1] == other.programs[1];
+    }
+    bool operator!=(const VoxelizationInputs& other) const { return !(*this == other); }
+};
+
+// Vertex fetch traffic of the mesh pass, queries are read back one frame late to avoid stalls
+struct FetchStats
+{
+    GLuint queries[2]{ 0 };
+    bool pending[2]{ false };
+    uint32_t vertexStride[2]{ 0 };
+    uint64_t indexBytes[2]{ 0 };
+    uint32_t frame{ 0 };
+
+    uint64_t lastVertexInvocations{ 0 };
+    uint64_t lastVertexBytes{ 0 };
+    uint64_t lastIndexBytes{ 0 };
+};
+
+struct CullStats
+{
+    uint32_t meshletsTested{ 0 };
+    uint32_t meshletsDrawn{ 0 };
+    uint32_t drawCommands{ 0 };
+};
+
+// Material map waiting for its streamed texture
+struct MapRef
+{
+    uint32_t material;
+    uint32_t slot;
+    TextureUsage usage;
+};
+
+// State of the streaming scene load, the load task fills the first block and then sets ready
+struct SceneStream
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    std::atomic<bool> ready{ false };
+    std::atomic<bool> cancel{ false }; // set at exit, the load task then skips the texture streamer
+    std::future<void> loadTask; // waited for before the GL objects it feeds are destroyed
+    bool warm{ false };
+    float hashMs{ 0 };
+    float loadMs{ 0 };
+    MappedFile cacheFile; // the blobs point into it when the scene comes from the cache
+    SceneData sceneData;
+    SceneView scene;
+    std::vector<PackedVertex> packedVertices;
+    std::vector<uint8_t> packedIndices;
+    std::vector<PackedIndexRange> packedRanges;
+    std::vector<uint32_t> axisIndices;
+    std::vector<AxisIndexRanges> axisRanges; // one per meshlet
+    std::vector<MapRef> mapRefs; // one per texture request
+
+    // GL thread only
+    bool buffersCreated{ false };
+    bool done{ false };
+    Clock::time_point start;
+    float firstFrameMs{ 0 };
 };
 
 Settings g_settings;
@@ -86,95 +214,78 @@ GLuint g_basicProgram;
 GLuint g_quadProgram;
 GLuint g_drawAABBProgram;
 GLuint g_drawAxesProgram;
-GLuint g_voxelizeProgram;
+GLuint g_voxelizeProgram; // geometry shader baseline, see Settings::gsVoxelizer
+GLuint g_voxelizeStatsProgram; // COLLECT_STATS permutation
+GLuint g_voxelizeSvoProgram; // SVO_FRAGMENT_LIST permutation
+GLuint g_voxelizeAxisProgram; // AXIS_DRAWS permutations of the three above, the default raster path
+GLuint g_voxelizeAxisStatsProgram;
+GLuint g_voxelizeAxisSvoProgram;
 GLuint g_drawVoxelsProgram;
+GLuint g_drawSvoProgram;
+ShaderCompiler g_shaderCompiler;
+FileWatcher g_shaderWatcher;
 
-GLuint g_voxelTex;
-
-GLuint UploadTexture(void* img, uint32_t width, uint32_t height, uint32_t channels)
-{
-    GLuint tex = 0;
-    glCreateTextures(GL_TEXTURE_2D, 1, &tex);
-
-    switch (channels) {
-    case 1:
-        glTextureStorage2D(tex, 1, GL_R8, width, height);
-        glTextureSubImage2D(tex, 0, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, img);
-        break;
-    case 2:
-        glTextureStorage2D(tex, 1, GL_RG8, width, height);
-        glTextureSubImage2D(tex, 0, 0, 0, width, height, GL_RG, GL_UNSIGNED_BYTE, img);
-        break;
-    case 3:
-        glTextureStorage2D(tex, 1, GL_RGB8, width, height);
-        glTextureSubImage2D(tex, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, img);
-        break;
-    case 4:
-        glTextureStorage2D(tex, 1, GL_RGBA8, width, height);
-        glTextureSubImage2D(tex, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, img);
-        break;
-    default:
-        std::cerr << "Unsupported texture channel count\n";
-        std::terminate();
-        break;
-    }
-
-    glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    return tex;
-}
-
-std::string LoadText(const char* path)
-{
-    std::ifstream ifs{ path };
-    if (!ifs.is_open()) {
-        std::cerr << "Could not open file \"" << path << "\"\n";
-        std::terminate();
-    }
-    
-    std::stringstream ss;
-    ss << ifs.rdbuf();
-    return ss.str();
-}
-
-// Create and return the shader
-GLuint CompileShader(const char* srcPath, GLenum type)
-{
-    GLuint shader = glCreateShader(type);
-    auto src = LoadText(srcPath);
-    auto srcCstr = src.c_str();
-    glShaderSource(shader, 1, &srcCstr, nullptr);
-    glCompileShader(shader);
-
-    int ok = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
-    if (!ok) {
-        char log[512] = {0};
-        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
-        std::cerr << "Failed to compile shader: " << log << '\n';
-        std::terminate();
-    }
-
-    return shader;
-}
-
-void LinkProgram(GLuint program)
-{
-    glLinkProgram(program);
-
-    int ok = 0;
-    glGetProgramiv(program, GL_LINK_STATUS, &ok);
-    if (!ok) {
-        char log[512];
-        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
-        std::cerr << "Failed to link program: " << log << '\n';
-        std::terminate();
-    }
-}
+// Shared by every program, written once per frame into the upload ring
+constexpr GLuint FRAME_UNIFORMS_BINDING = 0;
+GLint g_uniformBufferAlignment;
 
+constexpr uint32_t VOXEL_RESOLUTION = 512;
+// atomicImageAdd could only operate on integer images 
+constexpr GLuint VOXEL_IMAGE_BINDING = 0;
+GLuint g_voxelTex;
+VoxelizationInputs g_voxelizedInputs; // state the volume was last built from
+uint32_t g_voxelizeCount;
+
+// Sparse alternative to g_voxelTex, only the storage of the selected one exists
+constexpr uint32_t SVO_LEVELS = 10;
+SparseVoxelOctree g_svo;
+
+ComputeVoxelizer g_computeVoxelizer;
+
+// Filtered volume for cone tracing, exists along with the dense volume
+constexpr uint32_t VOXEL_MIP_RESOLUTION = VOXEL_RESOLUTION / 2;
+VoxelMipmap g_voxelMipmap;
+
+DiffuseGI g_diffuseGI;
+
+// All meshes live in one vertex and one index buffer behind a single VAO
+GLuint g_sceneVao;
+GLuint g_sceneVbo;
+GLuint g_sceneEbo;
+
+// Same geometry in the packed layout, see vertex_packing.h
+GLuint g_packedVao;
+GLuint g_packedVbo;
+GLuint g_packedEbo;
+
+// Indices sorted by dominant axis for the voxelizer, with the vertices of either layout
+GLuint g_axisVao;
+GLuint g_axisPackedVao;
+GLuint g_axisEbo;
+std::vector<AxisIndexRanges> g_meshletAxisRanges; // parallel to g_meshlets
+
+FetchStats g_fetchStats;
+
+// Meshlets of all meshes, CPU copy for culling and the same data in an SSBO for the GPU
+constexpr GLuint MESHLET_BUFFER_BINDING = 1;
+std::vector<Meshlet> g_meshlets;
+GLuint g_meshletBuffer;
+CullStats g_cullStats;
+
+// Bytes moved to the GPU per frame while streaming, keeps frame times bounded during the load
+constexpr size_t STREAMING_BUDGET = 8 * 1024 * 1024;
+constexpr size_t UPLOAD_RING_SIZE = 32 * 1024 * 1024;
+SceneStream g_stream;
+TextureStreamer g_textureStreamer;
+UploadRing g_uploadRing;
+GpuTimers g_gpuTimers;
+VoxelStats g_voxelStats;
+GLuint g_placeholderTextures[4]; // indexed by TextureUsage
+
+// Scene and voxelization programs are waited for, the visualizers become ready while the scene streams in
 void LoadShaders()
 {
+    PROFILE_FUNCTION();
     constexpr const char* BASIC_VS_PATH = "resources/shaders/basic.vert";
     constexpr const char* BASIC_FS_PATH = "resources/shaders/basic.frag";
     constexpr const char* QUAD_VS_PATH = "resources/shaders/quad.vert";
@@ -189,196 +300,373 @@ void LoadShaders()
     constexpr const char* DRAW_VOXELS_VS_PATH = "resources/shaders/draw_voxels.vert";
     constexpr const char* DRAW_VOXELS_GS_PATH = "resources/shaders/draw_voxels.geom";
     constexpr const char* DRAW_VOXELS_FS_PATH = "resources/shaders/draw_voxels.frag";
-
-    GLuint basicVs = CompileShader(BASIC_VS_PATH, GL_VERTEX_SHADER);
-    GLuint basicFs = CompileShader(BASIC_FS_PATH, GL_FRAGMENT_SHADER);
-    GLuint quadVs = CompileShader(QUAD_VS_PATH, GL_VERTEX_SHADER);
-    GLuint quadFs = CompileShader(QUAD_FS_PATH, GL_FRAGMENT_SHADER);
-    GLuint drawAABBVs = CompileShader(DRAW_AABB_VS_PATH, GL_VERTEX_SHADER);
-    GLuint drawAABBFs = CompileShader(DRAW_AABB_FS_PATH, GL_FRAGMENT_SHADER);
-    GLuint drawAxesVs = CompileShader(DRAW_AXES_VS_PATH, GL_VERTEX_SHADER);
-    GLuint drawAxesFs = CompileShader(DRAW_AXES_FS_PATH, GL_FRAGMENT_SHADER);
-    GLuint voxelizeVs = CompileShader(VOXELIZE_VS_PATH, GL_VERTEX_SHADER);
-    GLuint voxelizeGs = CompileShader(VOXELIZE_GS_PATH, GL_GEOMETRY_SHADER);
-    GLuint voxelizeFs = CompileShader(VOXELIZE_FS_PATH, GL_FRAGMENT_SHADER);
-    GLuint drawVoxelsVs = CompileShader(DRAW_VOXELS_VS_PATH, GL_VERTEX_SHADER);
-    GLuint drawVoxelsGs = CompileShader(DRAW_VOXELS_GS_PATH, GL_GEOMETRY_SHADER);
-    GLuint drawVoxelsFs = CompileShader(DRAW_VOXELS_FS_PATH, GL_FRAGMENT_SHADER);
-
-    g_basicProgram = glCreateProgram();
-    glAttachShader(g_basicProgram, basicVs);
-    glAttachShader(g_basicProgram, basicFs);
-    LinkProgram(g_basicProgram);
-    glDeleteShader(basicVs);
-    glDeleteShader(basicFs);
-
-    g_quadProgram = glCreateProgram();
-    glAttachShader(g_quadProgram, quadVs);
-    glAttachShader(g_quadProgram, quadFs);
-    LinkProgram(g_quadProgram);
-    glDeleteShader(quadVs);
-    glDeleteShader(quadFs);
-
-    g_drawAABBProgram = glCreateProgram();
-    glAttachShader(g_drawAABBProgram, drawAABBVs);
-    glAttachShader(g_drawAABBProgram, drawAABBFs);
-    LinkProgram(g_drawAABBProgram);
-    glDeleteShader(drawAABBVs);
-    glDeleteShader(drawAABBFs);
-
-    g_drawAxesProgram = glCreateProgram();
-    glAttachShader(g_drawAxesProgram, drawAxesVs);
-    glAttachShader(g_drawAxesProgram, drawAxesFs);
-    LinkProgram(g_drawAxesProgram);
-    glDeleteShader(drawAxesVs);
-    glDeleteShader(drawAxesFs);
-
-    g_voxelizeProgram = glCreateProgram();
-    glAttachShader(g_voxelizeProgram, voxelizeVs);
-    glAttachShader(g_voxelizeProgram, voxelizeGs);
-    glAttachShader(g_voxelizeProgram, voxelizeFs);
-    LinkProgram(g_voxelizeProgram);
-    glDeleteShader(voxelizeVs);
-    glDeleteShader(voxelizeGs);
-    glDeleteShader(voxelizeFs);
-
-    g_drawVoxelsProgram = glCreateProgram();
-    glAttachShader(g_drawVoxelsProgram, drawVoxelsVs);
-    glAttachShader(g_drawVoxelsProgram, drawVoxelsGs);
-    glAttachShader(g_drawVoxelsProgram, drawVoxelsFs);
-    LinkProgram(g_drawVoxelsProgram);
-    glDeleteShader(drawVoxelsVs);
-    glDeleteShader(drawVoxelsGs);
-    glDeleteShader(drawVoxelsFs);
+    constexpr const char* DRAW_SVO_FS_PATH = "resources/shaders/draw_svo.frag";
+
+    // Constants the shaders share with this file, the compiler folds them instead of reading uniforms
+    g_shaderCompiler.Init(glfwGetProcAddress, std::filesystem::path{ CACHE_PATH } / "shaders", {
+        MakeDefine("VOXEL_RESOLUTION", VOXEL_RESOLUTION),
+        MakeDefine("VOXEL_IMAGE_BINDING", VOXEL_IMAGE_BINDING),
+        MakeDefine("VOXEL_COUNTER_BINDING", VOXEL_COUNTER_BINDING),
+        MakeDefine("VOXEL_MIP_RESOLUTION", VOXEL_MIP_RESOLUTION),
+        MakeDefine("VOXEL_MIP_IMAGE_BINDING", VOXEL_MIP_IMAGE_BINDING),
+        MakeDefine("VOXEL_MIP_TEXTURE_UNIT", VOXEL_MIP_TEXTURE_UNIT),
+        MakeDefine("GI_GBUFFER_TEXTURE_UNIT", GI_GBUFFER_TEXTURE_UNIT),
+        MakeDefine("GI_TEXTURE_UNIT", GI_TEXTURE_UNIT),
+        MakeDefine("GI_IMAGE_BINDING", GI_IMAGE_BINDING),
+        MakeDefine("SVO_LEVELS", SVO_LEVELS),
+        MakeDefine("SVO_NODE_BINDING", SVO_NODE_BINDING),
+        MakeDefine("SVO_BRICK_BINDING", SVO_BRICK_BINDING),
+        MakeDefine("SVO_FRAGMENT_BINDING", SVO_FRAGMENT_BINDING),
+        MakeDefine("SVO_COUNTER_BINDING", SVO_COUNTER_BINDING),
+        MakeDefine("MESHLET_BUFFER_BINDING", MESHLET_BUFFER_BINDING),
+        MakeDefine("VOXELIZE_VERTEX_BINDING", VOXELIZE_VERTEX_BINDING),
+        MakeDefine("VOXELIZE_INDEX_BINDING", VOXELIZE_INDEX_BINDING),
+        MakeDefine("VOXELIZE_MESHLET_LIST_BINDING", VOXELIZE_MESHLET_LIST_BINDING),
+        MakeDefine("VOXELIZE_QUEUE_BINDING", VOXELIZE_QUEUE_BINDING),
+        MakeDefine("FRAME_UNIFORMS_BINDING", FRAME_UNIFORMS_BINDING) });
+
+    g_shaderCompiler.Submit(g_basicProgram, "basic", { 
+        { BASIC_VS_PATH, GL_VERTEX_SHADER }, 
+        { BASIC_FS_PATH, GL_FRAGMENT_SHADER } }, true);
+    g_shaderCompiler.Submit(g_voxelizeProgram, "voxelize", { 
+        { VOXELIZE_VS_PATH, GL_VERTEX_SHADER }, 
+        { VOXELIZE_GS_PATH, GL_GEOMETRY_SHADER }, 
+        { VOXELIZE_FS_PATH, GL_FRAGMENT_SHADER } }, false, 
+        { MakeDefine("COLLECT_STATS", 0), MakeDefine("SVO_FRAGMENT_LIST", 0), MakeDefine("AXIS_DRAWS", 0) });
+    g_shaderCompiler.Submit(g_voxelizeStatsProgram, "voxelize", { 
+        { VOXELIZE_VS_PATH, GL_VERTEX_SHADER }, 
+        { VOXELIZE_GS_PATH, GL_GEOMETRY_SHADER }, 
+        { VOXELIZE_FS_PATH, GL_FRAGMENT_SHADER } }, false, 
+        { MakeDefine("COLLECT_STATS", 1), MakeDefine("SVO_FRAGMENT_LIST", 0), MakeDefine("AXIS_DRAWS", 0) });
+    g_shaderCompiler.Submit(g_voxelizeSvoProgram, "voxelize", { 
+        { VOXELIZE_VS_PATH, GL_VERTEX_SHADER }, 
+        { VOXELIZE_GS_PATH, GL_GEOMETRY_SHADER }, 
+        { VOXELIZE_FS_PATH, GL_FRAGMENT_SHADER } }, false, 
+        { MakeDefine("COLLECT_STATS", 0), MakeDefine("SVO_FRAGMENT_LIST", 1), MakeDefine("AXIS_DRAWS", 0) });
+    g_shaderCompiler.Submit(g_voxelizeAxisProgram, "voxelize", { 
+        { VOXELIZE_VS_PATH, GL_VERTEX_SHADER }, 
+        { VOXELIZE_FS_PATH, GL_FRAGMENT_SHADER } }, true, 
+        { MakeDefine("COLLECT_STATS", 0), MakeDefine("SVO_FRAGMENT_LIST", 0), MakeDefine("AXIS_DRAWS", 1) });
+    g_shaderCompiler.Submit(g_voxelizeAxisStatsProgram, "voxelize", { 
+        { VOXELIZE_VS_PATH, GL_VERTEX_SHADER }, 
+        { VOXELIZE_FS_PATH, GL_FRAGMENT_SHADER } }, false, 
+        { MakeDefine("COLLECT_STATS", 1), MakeDefine("SVO_FRAGMENT_LIST", 0), MakeDefine("AXIS_DRAWS", 1) });
+    g_shaderCompiler.Submit(g_voxelizeAxisSvoProgram, "voxelize", { 
+        { VOXELIZE_VS_PATH, GL_VERTEX_SHADER }, 
+        { VOXELIZE_FS_PATH, GL_FRAGMENT_SHADER } }, false, 
+        { MakeDefine("COLLECT_STATS", 0), MakeDefine("SVO_FRAGMENT_LIST", 1), MakeDefine("AXIS_DRAWS", 1) });
+    g_shaderCompiler.Submit(g_quadProgram, "quad", { 
+        { QUAD_VS_PATH, GL_VERTEX_SHADER }, 
+        { QUAD_FS_PATH, GL_FRAGMENT_SHADER } }, false);
+    g_shaderCompiler.Submit(g_drawAABBProgram, "draw_aabb", { 
+        { DRAW_AABB_VS_PATH, GL_VERTEX_SHADER }, 
+        { DRAW_AABB_FS_PATH, GL_FRAGMENT_SHADER } }, false);
+    g_shaderCompiler.Submit(g_drawAxesProgram, "draw_axes", { 
+        { DRAW_AXES_VS_PATH, GL_VERTEX_SHADER }, 
+        { DRAW_AXES_FS_PATH, GL_FRAGMENT_SHADER } }, false);
+    g_shaderCompiler.Submit(g_drawVoxelsProgram, "draw_voxels", { 
+        { DRAW_VOXELS_VS_PATH, GL_VERTEX_SHADER }, 
+        { DRAW_VOXELS_GS_PATH, GL_GEOMETRY_SHADER }, 
+        { DRAW_VOXELS_FS_PATH, GL_FRAGMENT_SHADER } }, false);
+    g_shaderCompiler.Submit(g_drawSvoProgram, "draw_svo", { 
+        { QUAD_VS_PATH, GL_VERTEX_SHADER }, 
+        { DRAW_SVO_FS_PATH, GL_FRAGMENT_SHADER } }, false);
+    g_svo.SubmitShaders(g_shaderCompiler);
+    g_computeVoxelizer.SubmitShaders(g_shaderCompiler);
+    g_voxelMipmap.SubmitShaders(g_shaderCompiler);
+    g_diffuseGI.SubmitShaders(g_shaderCompiler);
+
+    g_shaderCompiler.WaitCritical();
+    g_shaderWatcher.Start(SHADER_DIR);
 }
 
-void MergeAABB(const aiScene* scene, glm::vec3* outAABB)
+TextureUsage ClassifyTexture(uint32_t slot, const std::string& path)
 {
-    glm::vec3 min{ std::numeric_limits<float>::max() };
-    glm::vec3 max{ std::numeric_limits<float>::min() };
-    for (uint32_t i = 0; i < scene->mNumMeshes; ++i) {
-        min = glm::min(min, Cast<glm::vec3>(scene->mMeshes[i]->mAABB.mMin));
-        max = glm::max(max, Cast<glm::vec3>(scene->mMeshes[i]->mAABB.mMax));
+    auto type = static_cast<aiTextureType>(slot + 1);
+    if (type == aiTextureType_NORMALS || type == aiTextureType_HEIGHT || 
+        path.find("_ddn") != std::string::npos || path.find("_normal") != std::string::npos) {
+        return TextureUsage::Normal;
+    }
+    if (type == aiTextureType_OPACITY || path.find("_mask") != std::string::npos) {
+        return TextureUsage::Mask;
     }
-    outAABB[0] = min;
-    outAABB[1] = max;
+    if (type == aiTextureType_DIFFUSE || type == aiTextureType_AMBIENT || type == aiTextureType_EMISSIVE) {
+        return TextureUsage::Color;
+    }
+    return TextureUsage::Generic;
 }
 
-void LoadScene()
+// Copy the ranges of one mesh into the scene buffers and make it drawable
+void UploadMesh(uint32_t meshIndex)
 {
-    const std::filesystem::path modelPath = MODEL_PATH;
-    auto objPath = modelPath;
-    objPath /= "sponza.obj";
-
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(objPath.string(),
-                                             aiProcess_CalcTangentSpace |
-                                             aiProcess_Triangulate |
-                                             aiProcess_JoinIdenticalVertices |
-                                             aiProcess_SortByPType |
-                                             aiProcess_GenBoundingBoxes);
-
-    if (!scene) {
-        std::cerr << importer.GetErrorString() << std::endl;
-        std::terminate();
-    }
+    PROFILE_FUNCTION();
+    const auto& scene = g_stream.scene;
+    const auto& record = scene.meshes[meshIndex];
+    const auto& packedRange = g_stream.packedRanges[meshIndex];
+
+    g_uploadRing.UploadBuffer(g_sceneVbo, size_t{ record.firstVertex } * sizeof(Vertex), 
+                              scene.vertices + record.firstVertex, size_t{ record.vertexCount } * sizeof(Vertex));
+    g_uploadRing.UploadBuffer(g_sceneEbo, size_t{ record.firstIndex } * sizeof(uint32_t), 
+                              scene.indices + record.firstIndex, size_t{ record.indexCount } * sizeof(uint32_t));
+    g_uploadRing.UploadBuffer(g_packedVbo, size_t{ record.firstVertex } * sizeof(PackedVertex), 
+                              g_stream.packedVertices.data() + record.firstVertex, 
+                              size_t{ record.vertexCount } * sizeof(PackedVertex));
+    g_uploadRing.UploadBuffer(g_packedEbo, packedRange.byteOffset, g_stream.packedIndices.data() + packedRange.byteOffset, 
+                              size_t{ record.indexCount } * packedRange.indexSize);
+    g_uploadRing.UploadBuffer(g_axisEbo, size_t{ record.firstIndex } * sizeof(uint32_t), 
+                              g_stream.axisIndices.data() + record.firstIndex, size_t{ record.indexCount } * sizeof(uint32_t));
+
+    Mesh mesh;
+    mesh.firstIndex = record.firstIndex;
+    mesh.indexCount = record.indexCount;
+    mesh.baseVertex = record.firstVertex;
+    mesh.materialIndex = record.materialIndex;
+    mesh.firstMeshlet = record.firstMeshlet;
+    mesh.meshletCount = record.meshletCount;
+    mesh.packedIndexOffset = packedRange.byteOffset;
+    mesh.packedIndexType = (packedRange.indexSize == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    mesh.aabb[0] = record.aabbMin;
+    mesh.aabb[1] = record.aabbMax;
+    g_meshes.push_back(mesh);
+}
 
-    std::cout << "--- Scene loaded successfully ---\n";
-    std::cout << "Mesh count: " << scene->mNumMeshes << '\n';
-    std::cout << "Material count: " << scene->mNumMaterials << '\n';
-    std::cout << "Texture count: " << scene->mNumTextures << '\n';
-    std::cout << "Material count: " << scene->mNumMaterials << '\n';
+// Vertex array of the scene vertices in either layout with the given index buffer
+GLuint CreateSceneVao(GLuint vbo, GLuint ebo, bool packed)
+{
+    GLuint vao;
+    glCreateVertexArrays(1, &vao);
+    glVertexArrayVertexBuffer(vao, 0, vbo, 0, packed ? sizeof(PackedVertex) : sizeof(Vertex));
+    glVertexArrayElementBuffer(vao, ebo);
+    glEnableVertexArrayAttrib(vao, 0);
+    glEnableVertexArrayAttrib(vao, 1);
+    glEnableVertexArrayAttrib(vao, 2);
+    if (packed) {
+        glVertexArrayAttribFormat(vao, 0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(PackedVertex, position));
+        glVertexArrayAttribFormat(vao, 1, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, normal));
+        glVertexArrayAttribFormat(vao, 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, texCoord));
+    }
+    else {
+        glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+        glVertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+        glVertexArrayAttribFormat(vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texCoord));
+    }
+    glVertexArrayAttribBinding(vao, 0, 0);
+    glVertexArrayAttribBinding(vao, 1, 0);
+    glVertexArrayAttribBinding(vao, 2, 0);
+    return vao;
+}
 
-    MergeAABB(scene, g_sceneAABB);
+// Allocate the scene buffers once the load task has finished, meshes are filled in by UploadMesh
+void CreateSceneBuffers()
+{
+    PROFILE_FUNCTION();
+    const auto& scene = g_stream.scene;
+    g_sceneAABB[0] = scene.aabb[0];
+    g_sceneAABB[1] = scene.aabb[1];
     std::cout << "Scene AABB: " << glm::to_string(g_sceneAABB[0]) << ", "
         << glm::to_string(g_sceneAABB[1]) << '\n';
 
-    g_materials.resize(scene->mNumMaterials);
-    g_meshes.resize(scene->mNumMeshes);
-
-    for (uint32_t i = 0; i < scene->mNumMaterials; ++i) {
-        auto material = scene->mMaterials[i];
-        aiString albedoPath, specularPath, normalPath;
-        std::cout << "- Material " << i << ": \n";
-        for (uint32_t j = 1; j < AI_TEXTURE_TYPE_MAX; ++j) {
-            if (material->GetTextureCount(static_cast<aiTextureType>(j))) {
-                aiString tmpPath;
-                material->GetTexture(static_cast<aiTextureType>(j), 0, &tmpPath);
-                std::filesystem::path texPath = modelPath;
-                texPath /= tmpPath.C_Str();
-                auto texPathStr = texPath.string();
-                std::replace(texPathStr.begin(), texPathStr.end(), '\\', '/');
-                std::cout << "  Map " << j << ": " << texPathStr << "; ";
-                int width = 0, height = 0, channels = 0;
-                auto img = stbi_load(texPathStr.c_str(), &width, &height, &channels, 0);
-                assert(img);
-                std::cout << "channels=" << channels << '\n';
-                g_materials[i].maps[j-1] = UploadTexture(img, width, height, channels);
-                stbi_image_free(img);
+    // Materials start out with placeholders, the streamer swaps in the real maps as they arrive
+    g_materials.resize(scene.materialCount);
+    for (uint32_t i = 0; i < scene.materialCount; ++i) {
+        g_materials[i].twoSided = scene.materials[i].twoSided != 0;
+    }
+    for (const auto& ref : g_stream.mapRefs) {
+        g_materials[ref.material].maps[ref.slot] = g_placeholderTextures[static_cast<int>(ref.usage)];
+    }
+    g_meshes.reserve(scene.meshCount);
+
+    // Immutable storage without data, the content comes through the upload ring
+    glCreateBuffers(1, &g_sceneVbo);
+    glCreateBuffers(1, &g_sceneEbo);
+    glNamedBufferStorage(g_sceneVbo, size_t{ scene.vertexCount } * sizeof(Vertex), nullptr, 0);
+    glNamedBufferStorage(g_sceneEbo, size_t{ scene.indexCount } * sizeof(uint32_t), nullptr, 0);
+
+    g_sceneVao = CreateSceneVao(g_sceneVbo, g_sceneEbo, false);
+
+    glCreateBuffers(1, &g_packedVbo);
+    glCreateBuffers(1, &g_packedEbo);
+    glNamedBufferStorage(g_packedVbo, g_stream.packedVertices.size() * sizeof(PackedVertex), nullptr, 0);
+    glNamedBufferStorage(g_packedEbo, g_stream.packedIndices.size(), nullptr, 0);
+
+    g_packedVao = CreateSceneVao(g_packedVbo, g_packedEbo, true);
+
+    // Always 32-bit, the sorted triangles of a mesh keep its range of the regular index buffer
+    glCreateBuffers(1, &g_axisEbo);
+    glNamedBufferStorage(g_axisEbo, size_t{ scene.indexCount } * sizeof(uint32_t), nullptr, 0);
+    g_axisVao = CreateSceneVao(g_sceneVbo, g_axisEbo, false);
+    g_axisPackedVao = CreateSceneVao(g_packedVbo, g_axisEbo, true);
+    g_meshletAxisRanges = std::move(g_stream.axisRanges);
+
+    // Small enough to go in one piece, meshes index into it as soon as they become resident
+    g_meshlets.assign(scene.meshlets, scene.meshlets + scene.meshletCount);
+    glCreateBuffers(1, &g_meshletBuffer);
+    glNamedBufferStorage(g_meshletBuffer, g_meshlets.size() * sizeof(Meshlet), nullptr, 0);
+    g_uploadRing.UploadBuffer(g_meshletBuffer, 0, g_meshlets.data(), g_meshlets.size() * sizeof(Meshlet));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESHLET_BUFFER_BINDING, g_meshletBuffer);
+
+    constexpr float MB = 1024.f * 1024.f;
+    std::cout << "Geometry: " << (scene.vertexCount * sizeof(Vertex) + scene.indexCount * sizeof(uint32_t)) / MB 
+        << " MB, packed: " << (g_stream.packedVertices.size() * sizeof(PackedVertex) + g_stream.packedIndices.size()) / MB 
+        << " MB, axis-sorted indices: " << scene.indexCount * sizeof(uint32_t) / MB << " MB\n";
+    uint64_t axisTriangles[3] = { 0 };
+    for (const auto& ranges : g_meshletAxisRanges) {
+        for (uint32_t axis = 0; axis < 3; ++axis) {
+            axisTriangles[axis] += ranges.indexCount[axis] / 3;
+        }
+    }
+    std::cout << "Dominant axis triangles: x " << axisTriangles[0] << ", y " << axisTriangles[1] << ", z " << axisTriangles[2] << '\n';
+
+    assert(glGetError() == GL_NO_ERROR);
+}
+
+std::filesystem::path SceneObjPath()
+{
+    return std::filesystem::path{ MODEL_PATH } / "sponza.obj";
+}
+
+// Maps the baked scene into g_stream.scene, importing and baking it first when the cache is stale
+void LoadSceneGeometry()
+{
+    PROFILE_FUNCTION();
+    auto ElapsedMs = [](SceneStream::Clock::time_point from) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(SceneStream::Clock::now() - from).count() / 1000.f;
+    };
+
+    auto objPath = SceneObjPath();
+    auto mtlPath = objPath;
+    mtlPath.replace_extension(".mtl");
+    auto cachePath = std::filesystem::path{ CACHE_PATH } / objPath.filename();
+    cachePath.replace_extension(".vctscene");
+
+    auto start = SceneStream::Clock::now();
+    uint64_t sourceHash = HashSourceFiles({ objPath, mtlPath });
+    g_stream.hashMs = ElapsedMs(start);
+
+    auto loadStart = SceneStream::Clock::now();
+    auto& scene = g_stream.scene;
+    g_stream.warm = LoadSceneCache(cachePath, sourceHash, g_stream.cacheFile, scene);
+    if (!g_stream.warm) {
+        ImportScene(objPath, g_stream.sceneData);
+        OptimizeScene(g_stream.sceneData);
+        BuildSceneMeshlets(g_stream.sceneData);
+        scene = g_stream.sceneData.View();
+        SaveSceneCache(cachePath, sourceHash, scene);
+    }
+    g_stream.loadMs = ElapsedMs(loadStart);
+}
+
+// Runs on the thread pool, everything it produces is published through g_stream.ready
+void LoadSceneTask(bool hasS3TC)
+{
+    PROFILE_FUNCTION();
+    LoadSceneGeometry();
+
+    auto packStart = SceneStream::Clock::now();
+    const auto& scene = g_stream.scene;
+    PackVertices(scene, g_stream.packedVertices);
+    PackIndices(scene, g_stream.packedIndices, g_stream.packedRanges);
+    SortTrianglesByAxis(scene, g_stream.axisIndices, g_stream.axisRanges);
+    g_stream.loadMs += std::chrono::duration_cast<std::chrono::microseconds>(SceneStream::Clock::now() - packStart).count() / 1000.f;
+
+    // Gather every map first so that the streamer can decode them in parallel
+    const std::filesystem::path modelPath = MODEL_PATH;
+    std::vector<TextureRequest> texRequests;
+    for (uint32_t i = 0; i < scene.materialCount; ++i) {
+        const auto& material = scene.materials[i];
+        for (uint32_t j = 0; j < material.mapCount; ++j) {
+            const auto& map = scene.maps[material.firstMap + j];
+            if (map.slot >= AI_TEXTURE_TYPE_MAX - 1) {
+                continue;
             }
+            auto mapPath = scene.MapPath(map);
+            auto usage = ClassifyTexture(map.slot, mapPath);
+            texRequests.push_back({ modelPath / mapPath, usage });
+            g_stream.mapRefs.push_back({ i, map.slot, usage });
         }
-        int32_t twoSided = 0;
-        if (material->Get(AI_MATKEY_TWOSIDED, twoSided)) {
-            g_materials[i].twoSided = true;
-        }
-        assert(glGetError() == GL_NO_ERROR);
-    }
-
-    for (uint32_t i = 0; i < scene->mNumMeshes; ++i) {
-        auto mesh = scene->mMeshes[i];
-
-        /* Load vertices */
-        std::vector<Vertex> vertices{ mesh->mNumVertices };
-        for (uint32_t j = 0; j < mesh->mNumVertices; ++j) {
-            vertices[j].position = glm::vec3(mesh->mVertices[j].x, 
-                                             mesh->mVertices[j].y, 
-                                             mesh->mVertices[j].z);
-            vertices[j].normal = glm::vec3(mesh->mNormals[j].x,
-                                           mesh->mNormals[j].y,
-                                           mesh->mNormals[j].z);
-            vertices[j].texCoord = glm::vec2(mesh->mTextureCoords[0][j].x,
-                                             1.f - mesh->mTextureCoords[0][j].y);
-        }
-
-        /* Load indices */
-        std::vector<glm::uvec3> faces{ mesh->mNumFaces };
-        for (uint32_t j = 0; j < mesh->mNumFaces; ++j) {
-            faces[j][0] = mesh->mFaces[j].mIndices[0];
-            faces[j][1] = mesh->mFaces[j].mIndices[1];
-            faces[j][2] = mesh->mFaces[j].mIndices[2];
-        }
-
-        g_meshes[i].vertexCount = faces.size() * 3;
-        g_meshes[i].materialIndex = mesh->mMaterialIndex;
-        
-        /* Upload data */
-        glCreateBuffers(1, &g_meshes[i].vbo);
-        glCreateBuffers(1, &g_meshes[i].ebo);
-        glCreateVertexArrays(1, &g_meshes[i].vao);
-        glNamedBufferStorage(g_meshes[i].vbo, mesh->mNumVertices * sizeof(Vertex), vertices.data(), 0);
-        glNamedBufferStorage(g_meshes[i].ebo, mesh->mNumFaces * sizeof(glm::uvec3), faces.data(), 0);
-
-        auto vao = g_meshes[i].vao;
-        glVertexArrayVertexBuffer(vao, 0, g_meshes[i].vbo, 0, sizeof(Vertex));
-        glVertexArrayElementBuffer(vao, g_meshes[i].ebo);
-        glEnableVertexArrayAttrib(vao, 0);
-        glEnableVertexArrayAttrib(vao, 1);
-        glEnableVertexArrayAttrib(vao, 2);
-        glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
-        glVertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
-        glVertexArrayAttribFormat(vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texCoord));
-        glVertexArrayAttribBinding(vao, 0, 0);
-        glVertexArrayAttribBinding(vao, 1, 0);
-        glVertexArrayAttribBinding(vao, 2, 0);
+    }
+    if (!g_stream.cancel.load(std::memory_order_relaxed)) {
+        g_textureStreamer.Start(texRequests, hasS3TC);
+    }
+
+    g_stream.ready.store(true, std::memory_order_release);
+}
+
+void StartSceneLoad()
+{
+    PROFILE_FUNCTION();
+    bool hasS3TC = HasGLExtension("GL_EXT_texture_compression_s3tc");
+    // std::function needs a copyable callable, the task is shared with the pool
+    auto task = std::make_shared<std::packaged_task<void()>>([hasS3TC] { LoadSceneTask(hasS3TC); });
+    g_stream.loadTask = task->get_future();
+    GetThreadPool().Submit([task] { (*task)(); });
+}
+
+// Called once per frame on the GL thread, makes as much of the scene resident as the budget allows
+void UpdateSceneStream()
+{
+    PROFILE_FUNCTION();
+    if (g_stream.done || !g_stream.ready.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    const auto& scene = g_stream.scene;
+    if (!g_stream.buffersCreated) {
+        CreateSceneBuffers();
+        g_stream.buffersCreated = true;
+        std::cout << "--- Scene loaded successfully (" << (g_stream.warm ? "warm, from cache" : "cold, imported") << ") ---\n";
+        std::cout << "Mesh count: " << scene.meshCount << '\n';
+        std::cout << "Material count: " << scene.materialCount << '\n';
+        std::cout << "Source hash: " << g_stream.hashMs << " ms\n";
+        std::cout << (g_stream.warm ? "Cache map: " : "Import and bake: ") << g_stream.loadMs << " ms\n";
+    }
+
+    size_t uploadedBytes = 0;
+    while (g_meshes.size() < scene.meshCount && uploadedBytes < STREAMING_BUDGET) {
+        const auto& record = scene.meshes[g_meshes.size()];
+        UploadMesh(static_cast<uint32_t>(g_meshes.size()));
+        // Full precision, packed and axis-sorted indices
+        uploadedBytes += size_t{ record.vertexCount } * (sizeof(Vertex) + sizeof(PackedVertex)) + 
+                         size_t{ record.indexCount } * (2 * sizeof(uint32_t) + g_stream.packedRanges[g_meshes.size() - 1].indexSize);
+    }
 
-        assert(glGetError() == GL_NO_ERROR);
+    bool meshesDone = g_meshes.size() == scene.meshCount;
+    if (meshesDone && g_stream.cacheFile.IsOpen()) {
+        // Every blob has been copied to the ring, the CPU side is not needed anymore
+        g_stream.cacheFile.Close();
     }
 
-	importer.FreeScene();
+    bool texturesDone = g_textureStreamer.Update(g_uploadRing, STREAMING_BUDGET - std::min(uploadedBytes, STREAMING_BUDGET), 
+        [](uint32_t request, GLuint texture) {
+            const auto& ref = g_stream.mapRefs[request];
+            g_materials[ref.material].maps[ref.slot] = texture;
+        });
+
+    if (meshesDone && texturesDone) {
+        g_stream.done = true;
+        g_stream.scene = SceneView{};
+        g_stream.sceneData = SceneData{};
+        g_stream.packedVertices = {};
+        g_stream.packedIndices = {};
+        g_stream.axisIndices = {};
+        std::cout << "--- Scene fully resident ---\n";
+#if VCT_PROFILER
+        // Startup is still entirely in the event rings at this point
+        if (Profiler::WriteChromeTrace(TRACE_PATH)) {
+            std::cout << "Startup trace written to " << TRACE_PATH << '\n';
+        }
+#endif
+        std::cout << "Time to first frame: " << g_stream.firstFrameMs << " ms\n";
+        std::cout << "Time to fully loaded: " << 
+            std::chrono::duration_cast<std::chrono::microseconds>(SceneStream::Clock::now() - g_stream.start).count() / 1000.f 
+            << " ms\n";
+    }
+    assert(glGetError() == GL_NO_ERROR);
 }
 
 void CreateWindow()
 {
+    PROFILE_FUNCTION();
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
@@ -399,10 +687,144 @@ void CreateWindow()
     }
 }
 
-constexpr uint32_t VOXEL_RESOLUTION = 512;
+// Location from the reflection taken at link time
+GLint UniformLocation(GLuint program, const char* name)
+{
+    return g_shaderCompiler.Reflection(program).Location(name);
+}
+
+void UploadFrameUniforms(const glm::mat4& proj)
+{
+    FrameUniforms uniforms;
+    uniforms.view = glm::inverse(g_camera.matrix);
+    uniforms.proj = proj;
+    uniforms.viewProj = proj * uniforms.view;
+    uniforms.sceneAABB[0] = glm::vec4(g_sceneAABB[0], 1);
+    uniforms.sceneAABB[1] = glm::vec4(g_sceneAABB[1], 1);
+    uniforms.cameraPosition = g_camera.matrix[3];
+
+    auto allocation = g_uploadRing.AllocateTransient(sizeof(uniforms), g_uniformBufferAlignment);
+    std::memcpy(allocation.data, &uniforms, sizeof(uniforms));
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, g_uploadRing.Buffer(), allocation.offset, sizeof(uniforms));
+}
+
+// Bind the scene geometry in the layout selected in the settings
+void BindSceneGeometry(GLuint program)
+{
+    glProgramUniform1i(program, UniformLocation(program, "u_packedVertices"), g_settings.packedVertices);
+    glBindVertexArray(g_settings.packedVertices ? g_packedVao : g_sceneVao);
+}
+
+// Layout defined by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// Draw commands of one mesh with a single indirect multi-draw, the commands go through the upload ring
+void SubmitDrawCommands(GLuint program, const Mesh& mesh, GLenum indexType, 
+                        const std::vector<DrawElementsIndirectCommand>& commands)
+{
+    if (g_settings.packedVertices) {
+        glProgramUniform3fv(program, UniformLocation(program, "u_meshAABB"), 2, glm::value_ptr(mesh.aabb[0]));
+    }
+    size_t commandBytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+    auto allocation = g_uploadRing.AllocateTransient(commandBytes, sizeof(uint32_t));
+    std::memcpy(allocation.data, commands.data(), commandBytes);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, g_uploadRing.Buffer());
+    glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, reinterpret_cast<const void*>(allocation.offset), 
+                                static_cast<GLsizei>(commands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    g_cullStats.drawCommands += static_cast<uint32_t>(commands.size());
+}
+
+/*
+ * Draw the meshlets of a mesh that pass isVisible with a single indirect multi-draw, 
+ * adjacent visible meshlets are merged into one command. Returns the number of indices drawn.
+ */
+template <typename Predicate>
+uint32_t DrawMeshlets(GLuint program, const Mesh& mesh, Predicate isVisible)
+{
+    static std::vector<DrawElementsIndirectCommand> commands;
+    commands.clear();
+
+    const bool packed = g_settings.packedVertices;
+    const GLenum indexType = packed ? mesh.packedIndexType : GL_UNSIGNED_INT;
+    const uint32_t indexSize = (indexType == GL_UNSIGNED_SHORT) ? 2 : 4;
+    // firstIndex counts elements of the bound index buffer
+    const uint32_t meshFirstIndex = packed ? mesh.packedIndexOffset / indexSize : mesh.firstIndex;
+
+    uint32_t drawnIndices = 0;
+    uint32_t rangeEnd = ~0u;
+    for (uint32_t i = 0; i < mesh.meshletCount; ++i) {
+        const auto& meshlet = g_meshlets[mesh.firstMeshlet + i];
+        ++g_cullStats.meshletsTested;
+        if (!isVisible(meshlet)) {
+            continue;
+        }
+        ++g_cullStats.meshletsDrawn;
 
-void VoxelizeScene()
+        uint32_t firstIndex = meshFirstIndex + (meshlet.firstIndex - mesh.firstIndex);
+        if (firstIndex == rangeEnd) {
+            commands.back().count += meshlet.indexCount;
+        }
+        else {
+            commands.push_back({ meshlet.indexCount, 1, firstIndex, static_cast<int32_t>(mesh.baseVertex), 0 });
+        }
+        rangeEnd = firstIndex + meshlet.indexCount;
+        drawnIndices += meshlet.indexCount;
+    }
+
+    if (!commands.empty()) {
+        SubmitDrawCommands(program, mesh, indexType, commands);
+    }
+    return drawnIndices;
+}
+
+// Same as DrawMeshlets for the triangles of the meshlets with the given dominant axis, from g_axisEbo
+template <typename Predicate>
+uint32_t DrawMeshletsOfAxis(GLuint program, const Mesh& mesh, uint32_t axis, Predicate isVisible)
+{
+    static std::vector<DrawElementsIndirectCommand> commands;
+    commands.clear();
+
+    uint32_t drawnIndices = 0;
+    uint32_t rangeEnd = ~0u;
+    for (uint32_t i = mesh.firstMeshlet; i < mesh.firstMeshlet + mesh.meshletCount; ++i) {
+        const auto& ranges = g_meshletAxisRanges[i];
+        if (ranges.indexCount[axis] == 0 || !isVisible(g_meshlets[i])) {
+            continue;
+        }
+        if (ranges.firstIndex[axis] == rangeEnd) {
+            commands.back().count += ranges.indexCount[axis];
+        }
+        else {
+            commands.push_back({ ranges.indexCount[axis], 1, ranges.firstIndex[axis], static_cast<int32_t>(mesh.baseVertex), 0 });
+        }
+        rangeEnd = ranges.firstIndex[axis] + ranges.indexCount[axis];
+        drawnIndices += ranges.indexCount[axis];
+    }
+
+    if (!commands.empty()) {
+        SubmitDrawCommands(program, mesh, GL_UNSIGNED_INT, commands);
+    }
+    return drawnIndices;
+}
+
+/*
+ * Rasterize the scene into the bound voxel image or fragment list. The program is one of the voxelize
+ * permutations, with axisDraws an AXIS_DRAWS one: the axis-sorted triangles are drawn once per projection.
+ * Without it a single draw goes through the geometry shader picking the projection per triangle, which
+ * is only kept as the baseline to benchmark against.
+ * Meshes before firstMesh are skipped, they are already in the volume.
+ */
+void VoxelizeScene(GLuint program, uint32_t resolution, bool axisDraws, uint32_t firstMesh = 0)
 {
+    PROFILE_FUNCTION();
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
     glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
@@ -410,18 +832,100 @@ void VoxelizeScene()
     GLint viewport[4];
     glGetIntegerv(GL_VIEWPORT, viewport);
 
-    glProgramUniform3fv(g_voxelizeProgram, glGetUniformLocation(g_voxelizeProgram, "u_sceneAABB"), 2, glm::value_ptr(g_sceneAABB[0]));
-	glProgramUniform1ui(g_voxelizeProgram, glGetUniformLocation(g_voxelizeProgram, "u_voxelResolution"), VOXEL_RESOLUTION);
-    glUseProgram(g_voxelizeProgram);
-    glViewport(0, 0, VOXEL_RESOLUTION, VOXEL_RESOLUTION);
-
-    for (uint32_t i = 0; i < g_meshes.size(); ++i) {
-        glBindVertexArray(g_meshes[i].vao);
-        glDrawElements(GL_TRIANGLES, g_meshes[i].vertexCount, GL_UNSIGNED_INT, 0);
+    glUseProgram(program);
+    glViewport(0, 0, resolution, resolution);
+
+    // The volume spans the scene AABB, the bound of this very geometry, so no cluster lies outside of it.
+    // Incremental runs are limited by firstMesh instead.
+    auto everyMeshlet = [](const Meshlet&) { return true; };
+    if (axisDraws) {
+        glProgramUniform1i(program, UniformLocation(program, "u_packedVertices"), g_settings.packedVertices);
+        glBindVertexArray(g_settings.packedVertices ? g_axisPackedVao : g_axisVao);
+        const GLint axisLocation = UniformLocation(program, "u_dominantAxis");
+        for (uint32_t axis = 0; axis < 3; ++axis) {
+            glProgramUniform1i(program, axisLocation, axis);
+            for (uint32_t i = firstMesh; i < g_meshes.size(); ++i) {
+                DrawMeshletsOfAxis(program, g_meshes[i], axis, everyMeshlet);
+            }
+        }
+    }
+    else {
+        BindSceneGeometry(program);
+        for (uint32_t i = firstMesh; i < g_meshes.size(); ++i) {
+            DrawMeshlets(program, g_meshes[i], everyMeshlet);
+        }
     }
 
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    // The voxel passes read the volume with image loads, they must see every atomic written above
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+// Same meshlets as VoxelizeScene draws, through the compute voxelizer
+void VoxelizeSceneCompute(bool collectStats, uint32_t firstMesh = 0)
+{
+    PROFILE_FUNCTION();
+    static std::vector<uint32_t> meshlets;
+    meshlets.clear();
+    for (uint32_t meshIndex = firstMesh; meshIndex < g_meshes.size(); ++meshIndex) {
+        const auto& mesh = g_meshes[meshIndex];
+        for (uint32_t i = mesh.firstMeshlet; i < mesh.firstMeshlet + mesh.meshletCount; ++i) {
+            meshlets.push_back(i);
+        }
+    }
+    g_computeVoxelizer.Voxelize(g_shaderCompiler, g_uploadRing, g_sceneVbo, g_sceneEbo, meshlets, collectStats);
+}
+
+// Voxels of the dense volume the meshes from firstMesh on can write, padded by a voxel against rounding
+void MeshVoxelRegion(uint32_t firstMesh, glm::uvec3& outFirst, glm::uvec3& outLast)
+{
+    glm::vec3 aabb[2] = { glm::vec3{ std::numeric_limits<float>::max() }, glm::vec3{ std::numeric_limits<float>::lowest() } };
+    for (uint32_t i = firstMesh; i < g_meshes.size(); ++i) {
+        aabb[0] = glm::min(aabb[0], g_meshes[i].aabb[0]);
+        aabb[1] = glm::max(aabb[1], g_meshes[i].aabb[1]);
+    }
+    const glm::vec3 scale = float(VOXEL_RESOLUTION) / (g_sceneAABB[1] - g_sceneAABB[0]);
+    const glm::vec3 maxVoxel{ float(VOXEL_RESOLUTION - 1) };
+    outFirst = glm::uvec3{ glm::clamp(glm::floor((aabb[0] - g_sceneAABB[0]) * scale) - 1.f, glm::vec3{ 0 }, maxVoxel) };
+    outLast = glm::uvec3{ glm::clamp(glm::floor((aabb[1] - g_sceneAABB[0]) * scale) + 1.f, glm::vec3{ 0 }, maxVoxel) };
+}
+
+void BuildSparseVoxelOctree(GLuint voxelizeProgram, bool axisDraws)
+{
+    PROFILE_FUNCTION();
+    // The fragment list grows to what the scene needs, the first build after a change may voxelize twice
+    do {
+        g_svo.BeginFragments();
+        VoxelizeScene(voxelizeProgram, g_svo.Resolution(), axisDraws);
+    } while (!g_svo.EndFragments());
+    g_svo.Build(g_shaderCompiler);
+}
+
+// Keep only the storage of the selected voxel backend, the dense volume alone is 512 MB
+void SelectVoxelBackend(bool sparse)
+{
+    if (sparse ? g_svo.IsCreated() : g_voxelTex != 0) {
+        return;
+    }
+    if (sparse) {
+        glDeleteTextures(1, &g_voxelTex);
+        g_voxelTex = 0;
+        g_voxelMipmap.Destroy();
+        g_svo.Create(SVO_LEVELS);
+    }
+    else {
+        g_svo.Destroy();
+        glCreateTextures(GL_TEXTURE_3D, 1, &g_voxelTex);
+        glTextureStorage3D(g_voxelTex, 1, GL_R32UI, 
+                           VOXEL_RESOLUTION, 
+                           VOXEL_RESOLUTION, 
+                           VOXEL_RESOLUTION);
+        g_voxelMipmap.Create(VOXEL_RESOLUTION);
+    }
+    // The new storage is empty
+    g_voxelizedInputs = VoxelizationInputs{};
 }
 
 void UpdateCamera(float frameTimeMs)
@@ -455,27 +959,181 @@ void UpdateCamera(float frameTimeMs)
 	}
 }
 
-int main()
+// Headless benchmark of the CPU voxelizer over the baked scene, no window or GL context is created
+int RunCpuVoxelizer(bool fillInterior, bool save)
+{
+    PROFILE_FUNCTION();
+    LoadSceneGeometry();
+    const auto& scene = g_stream.scene;
+    std::cout << "--- CPU voxelizer (" << GetThreadPool().ThreadCount() + 1 << " threads" << (fillInterior ? ", solid" : "") << ") ---\n";
+    std::cout << "Triangles: " << scene.indexCount / 3 << '\n';
+    std::cout << (g_stream.warm ? "Cache map: " : "Import and bake: ") << g_stream.loadMs << " ms\n";
+
+    VoxelGrid grid;
+    for (uint32_t resolution = 128; resolution <= 1024; resolution *= 2) {
+        auto stats = VoxelizeSceneCpu(scene, scene.aabb, resolution, fillInterior, grid);
+        std::cout << resolution << "^3: " << stats.TotalMs() << " ms (bin " << stats.binMs << ", voxelize " << stats.voxelizeMs;
+        if (fillInterior) {
+            std::cout << ", fill " << stats.fillMs;
+        }
+        std::cout << "), " << stats.occupiedVoxels << " voxels, " << stats.binnedTriangles << " binned triangles, "
+                  << stats.TrianglesPerSecond() / 1e6 << " Mtris/s, " << stats.VoxelsPerSecond() / 1e6 << " Mvoxels/s\n";
+        if (save) {
+            auto path = std::filesystem::path{ CACHE_PATH } / ("voxels_" + std::to_string(resolution) + ".vctvox");
+            if (SaveVoxelGrid(path, grid, scene.aabb)) {
+                std::cout << "Saved " << path.string() << '\n';
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Round trip of a synthetic image through every block format without a GL context: gradients, noise and
+ * hard edges with a size that is not a multiple of 4, plus a flat image that must survive up to endpoint
+ * quantization. Fails when an error bound is exceeded or the encode rate is not a sane number.
+ */
+int RunBlockCompressionTest()
 {
+    struct Case
+    {
+        BlockFormat format;
+        uint32_t channels; // compared, from r on
+        float maxRmse;
+        int maxError;
+        int maxFlatError; // 565 endpoints round by up to 4, the 7-bit BC7 ones by 1
+    };
+    constexpr Case CASES[] = {
+        { BlockFormat::BC1, 3, 6.f, 48, 4 },
+        { BlockFormat::BC3, 4, 6.f, 48, 4 },
+        { BlockFormat::BC4, 1, 1.f, 2, 0 },
+        { BlockFormat::BC5, 2, 1.5f, 4, 0 },
+        { BlockFormat::BC7, 4, 4.f, 32, 1 },
+    };
+    constexpr uint32_t WIDTH = 509, HEIGHT = 347;
+
+    std::vector<uint8_t> image(size_t{ WIDTH } * HEIGHT * 4);
+    uint32_t seed = 1;
+    for (uint32_t y = 0; y < HEIGHT; ++y) {
+        for (uint32_t x = 0; x < WIDTH; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            const int noise = static_cast<int>((seed >> 24) % 9) - 4;
+            uint8_t* pixel = &image[4 * (size_t{ y } * WIDTH + x)];
+            pixel[0] = static_cast<uint8_t>(std::clamp(static_cast<int>(255.f * x / (WIDTH - 1)) + noise, 0, 255));
+            pixel[1] = static_cast<uint8_t>(std::clamp(static_cast<int>(127.5f + 127.5f * std::sin(y * 0.05f)) + noise, 0, 255));
+            pixel[2] = ((x / 37 + y / 29) % 2) ? 200 : 40;
+            pixel[3] = static_cast<uint8_t>(std::clamp(static_cast<int>(255.f * y / (HEIGHT - 1)) + noise, 0, 255));
+        }
+    }
+    std::vector<uint8_t> flat(size_t{ 16 } * 16 * 4);
+    for (size_t i = 0; i < flat.size(); i += 4) {
+        flat[i + 0] = 173;
+        flat[i + 1] = 94;
+        flat[i + 2] = 21;
+        flat[i + 3] = 222;
+    }
+
+    auto MaxError = [](const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, uint32_t channels, double& outRmse) {
+        double squared = 0;
+        int maxError = 0;
+        const size_t pixels = a.size() / 4;
+        for (size_t i = 0; i < pixels; ++i) {
+            for (uint32_t k = 0; k < channels; ++k) {
+                const int error = std::abs(int{ a[4 * i + k] } - int{ b[4 * i + k] });
+                squared += double(error) * error;
+                maxError = std::max(maxError, error);
+            }
+        }
+        outRmse = std::sqrt(squared / (pixels * channels));
+        return maxError;
+    };
+
+    std::cout << "--- Block compression test (" << WIDTH << "x" << HEIGHT << ") ---\n";
+    bool passed = true;
+    for (const auto& test : CASES) {
+        std::vector<uint8_t> compressed(CompressedImageSize(test.format, WIDTH, HEIGHT));
+        std::vector<uint8_t> decoded(image.size());
+        auto start = std::chrono::high_resolution_clock::now();
+        CompressImage(test.format, image.data(), WIDTH, HEIGHT, compressed.data());
+        const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        // Same rate as the texture streamer reports, source RGBA8 bytes per second
+        const double mbPerSecond = image.size() / (1024.0 * 1024.0) / std::max(seconds, 1e-9);
+        DecompressImage(test.format, compressed.data(), WIDTH, HEIGHT, decoded.data());
+        double rmse;
+        const int maxError = MaxError(image, decoded, test.channels, rmse);
+
+        std::vector<uint8_t> flatCompressed(CompressedImageSize(test.format, 16, 16));
+        std::vector<uint8_t> flatDecoded(flat.size());
+        CompressImage(test.format, flat.data(), 16, 16, flatCompressed.data());
+        DecompressImage(test.format, flatCompressed.data(), 16, 16, flatDecoded.data());
+        double flatRmse;
+        const int flatError = MaxError(flat, flatDecoded, test.channels, flatRmse);
+
+        const bool ok = rmse <= test.maxRmse && maxError <= test.maxError && flatError <= test.maxFlatError &&
+                        std::isfinite(mbPerSecond) && mbPerSecond > 0;
+        passed = passed && ok;
+        std::cout << BlockFormatName(test.format) << ": RMSE " << rmse << " (<= " << test.maxRmse << "), max error " << maxError
+                  << " (<= " << test.maxError << "), flat " << flatError << " (<= " << test.maxFlatError << "), "
+                  << mbPerSecond << " MB/s" << (ok ? "" : "  FAILED") << '\n';
+    }
+    std::cout << (passed ? "Passed\n" : "Failed\n");
+    return passed ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    PROFILE_THREAD("Main");
+    // --cpu-voxelize [--fill] [--save] runs the CPU voxelizer benchmark instead of the viewer,
+    // --bc-test the headless block compression round trip
+    bool cpuVoxelize = false;
+    bool bcTest = false;
+    bool fillInterior = false;
+    bool saveGrids = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--cpu-voxelize") == 0) {
+            cpuVoxelize = true;
+        } else if (std::strcmp(argv[i], "--bc-test") == 0) {
+            bcTest = true;
+        } else if (std::strcmp(argv[i], "--fill") == 0) {
+            fillInterior = true;
+        } else if (std::strcmp(argv[i], "--save") == 0) {
+            saveGrids = true;
+        } else {
+            std::cerr << "Unknown argument \"" << argv[i] << "\"\n";
+        }
+    }
+    if (bcTest) {
+        return RunBlockCompressionTest();
+    }
+    if (cpuVoxelize) {
+        return RunCpuVoxelizer(fillInterior, saveGrids);
+    }
+
+    g_stream.start = SceneStream::Clock::now();
     CreateWindow();
     LoadShaders();
-    LoadScene();
+
+    // The scene streams in while the render loop is already running
+    g_uploadRing.Create(UPLOAD_RING_SIZE);
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &g_uniformBufferAlignment);
+    for (int i = 0; i < 4; ++i) {
+        g_placeholderTextures[i] = CreatePlaceholderTexture(g_uploadRing, static_cast<TextureUsage>(i));
+    }
+    StartSceneLoad();
 
     // VAO with no buffer binding, used when geometry is generated in shaders
     GLuint genericDrawVao;
     glCreateVertexArrays(1, &genericDrawVao);
 
-    // Create texture for voxelization
-    // atomicImageAdd could only operate on integer images 
-    constexpr GLuint VOXEL_IMAGE_BINDING = 0;
-    glCreateTextures(GL_TEXTURE_3D, 1, &g_voxelTex);
-    glTextureStorage3D(g_voxelTex, 1, GL_R32UI, 
-                       VOXEL_RESOLUTION, 
-                       VOXEL_RESOLUTION, 
-                       VOXEL_RESOLUTION);
-    glBindImageTexture(VOXEL_IMAGE_BINDING, g_voxelTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    // Create storage for voxelization
+    SelectVoxelBackend(g_settings.sparseVoxels);
     assert(glGetError() == GL_NO_ERROR);
 
+    glCreateQueries(GL_VERTEX_SHADER_INVOCATIONS, 2, g_fetchStats.queries);
+    g_gpuTimers.Create();
+    g_voxelStats.Create();
+    g_computeVoxelizer.Create();
+
 
     IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -502,6 +1160,8 @@ int main()
 
     while (!glfwWindowShouldClose(g_window))
     {
+        PROFILE_FRAME();
+        g_gpuTimers.BeginFrame();
 		int32_t windowWidth, windowHeight;
 		glfwGetWindowSize(g_window, &windowWidth, &windowHeight);
 
@@ -515,6 +1175,13 @@ int main()
         last = now;
 
         UpdateCamera(frameTimeMs);
+        UpdateSceneStream();
+        auto changedShaders = g_shaderWatcher.Poll();
+        if (!changedShaders.empty()) {
+            g_shaderCompiler.Reload(changedShaders);
+        }
+        g_shaderCompiler.Poll();
+        UploadFrameUniforms(proj);
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -525,7 +1192,85 @@ int main()
 
 
         /******************************************** BEGIN DRAW ********************************************/
-		VoxelizeScene();
+        const bool sparseVoxels = g_settings.sparseVoxels;
+        const bool computeVoxelizer = !sparseVoxels && g_settings.computeVoxelizer;
+        const bool axisDraws = !computeVoxelizer && !g_settings.gsVoxelizer;
+        const GLuint rasterProgram = axisDraws ? g_voxelizeAxisProgram : g_voxelizeProgram;
+        const GLuint rasterStatsProgram = axisDraws ? g_voxelizeAxisStatsProgram : g_voxelizeStatsProgram;
+        const GLuint rasterSvoProgram = axisDraws ? g_voxelizeAxisSvoProgram : g_voxelizeSvoProgram;
+        SelectVoxelBackend(sparseVoxels);
+        bool collectVoxelStats = !sparseVoxels && g_settings.voxelStats && 
+                                 (computeVoxelizer ? g_computeVoxelizer.IsReady(g_shaderCompiler, true) :
+                                                     g_shaderCompiler.IsReady(rasterStatsProgram));
+        bool voxelizeReady = sparseVoxels ? g_shaderCompiler.IsReady(rasterSvoProgram) && g_svo.IsReady(g_shaderCompiler) :
+                             computeVoxelizer ? g_computeVoxelizer.IsReady(g_shaderCompiler, collectVoxelStats) : 
+                             g_shaderCompiler.IsReady(rasterProgram);
+        VoxelizationInputs voxelInputs;
+        voxelInputs.meshCount = static_cast<uint32_t>(g_meshes.size());
+        voxelInputs.aabb[0] = g_sceneAABB[0];
+        voxelInputs.aabb[1] = g_sceneAABB[1];
+        voxelInputs.resolution = sparseVoxels ? g_svo.Resolution() : VOXEL_RESOLUTION;
+        voxelInputs.packedVertices = g_settings.packedVertices;
+        if (sparseVoxels) {
+            voxelInputs.programs[0] = rasterSvoProgram;
+        }
+        else if (computeVoxelizer) {
+            voxelInputs.programs[0] = g_computeVoxelizer.TriangleProgram(collectVoxelStats);
+            voxelInputs.programs[1] = g_computeVoxelizer.TileProgram(collectVoxelStats);
+        }
+        else {
+            voxelInputs.programs[0] = collectVoxelStats ? rasterStatsProgram : rasterProgram;
+        }
+        // Meshes that streamed in since the last build are voxelized on top of it when nothing else changed,
+        // stats runs always start from an empty volume
+        VoxelizationInputs extendedInputs = g_voxelizedInputs;
+        extendedInputs.meshCount = voxelInputs.meshCount;
+        const bool incremental = !sparseVoxels && !collectVoxelStats && !g_settings.voxelizeEveryFrame &&
+                                 voxelInputs.meshCount > g_voxelizedInputs.meshCount && extendedInputs == voxelInputs;
+        // The octree cannot grow incrementally and every build stalls on its readbacks, so it is only built
+        // once the scene is fully resident. Until then the previous tree stays in place.
+        const bool sceneSettled = !sparseVoxels || g_stream.done;
+        if (voxelizeReady && sceneSettled && (g_settings.voxelizeEveryFrame || voxelInputs != g_voxelizedInputs)) {
+            // Separate timers and stats engines per voxelizer, so that they can be compared side by side
+            const char* engine = computeVoxelizer ? "compute" : axisDraws ? "raster" : "raster GS";
+            ScopedGpuTimer gpuTimer{ g_gpuTimers, computeVoxelizer ? "Voxelize compute" : axisDraws ? "Voxelize" : "Voxelize GS" };
+            if (sparseVoxels) {
+                BuildSparseVoxelOctree(voxelInputs.programs[0], axisDraws);
+            }
+            else {
+                // Stale voxels would survive otherwise, and the stats count collisions against an empty volume
+                const uint32_t firstMesh = incremental ? g_voxelizedInputs.meshCount : 0;
+                if (incremental) {
+                    glm::uvec3 first, last;
+                    MeshVoxelRegion(firstMesh, first, last);
+                    g_voxelMipmap.MarkDirty(first, last);
+                }
+                else {
+                    uint32_t zero = 0;
+                    glClearTexImage(g_voxelTex, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+                    g_voxelMipmap.MarkAllDirty();
+                }
+                glBindImageTexture(VOXEL_IMAGE_BINDING, g_voxelTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+                if (collectVoxelStats) {
+                    g_voxelStats.Begin(VOXEL_RESOLUTION, engine);
+                }
+                if (computeVoxelizer) {
+                    VoxelizeSceneCompute(collectVoxelStats, firstMesh);
+                }
+                else {
+                    VoxelizeScene(voxelInputs.programs[0], VOXEL_RESOLUTION, axisDraws, firstMesh);
+                }
+                if (collectVoxelStats) {
+                    g_voxelStats.End();
+                }
+            }
+            g_voxelizedInputs = voxelInputs;
+            ++g_voxelizeCount;
+        }
+        if (!sparseVoxels && g_voxelMipmap.IsDirty()) {
+            glBindImageTexture(VOXEL_IMAGE_BINDING, g_voxelTex, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R32UI);
+            g_voxelMipmap.Update(g_shaderCompiler, g_gpuTimers, g_settings.mipLevelsPerDispatch, g_settings.refilterDirtyRegion);
+        }
 
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -537,10 +1282,43 @@ int main()
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 		}
 
+        // The mesh pass goes through the G-buffer instead, lit by the GI once it is traced
+        const uint32_t giQuality = static_cast<uint32_t>(g_settings.giQuality);
+        const bool diffuseGI = g_settings.showMesh && g_settings.diffuseGI && !sparseVoxels && 
+                               windowWidth > 0 && windowHeight > 0 && g_diffuseGI.IsReady(g_shaderCompiler, giQuality);
+        if (diffuseGI) {
+            g_diffuseGI.Resize(g_settings.giAt1080p ? 1920 : windowWidth, g_settings.giAt1080p ? 1080 : windowHeight, 
+                               g_settings.giDownscale);
+        }
+
+        g_cullStats = CullStats{};
         if (g_settings.showMesh) {
+            PROFILE_SCOPE("Mesh pass");
+            ScopedGpuTimer gpuTimer{ g_gpuTimers, "Mesh pass" };
+            auto& stats = g_fetchStats;
+            uint32_t slot = stats.frame % 2;
+            stats.vertexStride[slot] = g_settings.packedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+            stats.indexBytes[slot] = 0;
+            stats.pending[slot] = true;
+            glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS, stats.queries[slot]);
+
+            BindSceneGeometry(g_basicProgram);
+
+            glm::vec4 frustumPlanes[6];
+            ExtractFrustumPlanes(proj * glm::inverse(g_camera.matrix), frustumPlanes);
+            glm::vec3 eye{ g_camera.matrix[3] };
+            if (diffuseGI) {
+                g_diffuseGI.BeginGBuffer();
+            }
+            else {
+                glViewport(0, 0, windowWidth, windowHeight);
+            }
+            glEnable(GL_DEPTH_TEST);
+            glUseProgram(g_basicProgram);
+            const GLint hasMapLocation = UniformLocation(g_basicProgram, "u_hasMap");
             for (uint32_t i = 0; i < g_meshes.size(); ++i) {
                 uint32_t hasMap[8] = { 0 };
-                auto mat = g_materials[g_meshes[i].materialIndex];
+                const auto& mat = g_materials[g_meshes[i].materialIndex];
                 for (uint32_t j = 0; j < 8; ++j) {
                     auto tex = mat.maps[j];
                     if (tex) {
@@ -548,13 +1326,7 @@ int main()
                         hasMap[j] = 1;
                     }
                 }
-                glViewport(0, 0, windowWidth, windowHeight);
-                glEnable(GL_DEPTH_TEST);
-                glProgramUniform1uiv(g_basicProgram, glGetUniformLocation(g_basicProgram, "u_hasMap"), 8, hasMap);
-                glProgramUniformMatrix4fv(g_basicProgram, glGetUniformLocation(g_basicProgram, "u_proj"), 1, GL_FALSE, glm::value_ptr(proj));
-                glProgramUniformMatrix4fv(g_basicProgram, glGetUniformLocation(g_basicProgram, "u_view"), 1, GL_FALSE, glm::value_ptr(glm::inverse(g_camera.matrix)));
-                glBindVertexArray(g_meshes[i].vao);
-                glUseProgram(g_basicProgram);
+                glProgramUniform1uiv(g_basicProgram, hasMapLocation, 8, hasMap);
                 if (mat.twoSided) {
                     glDisable(GL_CULL_FACE);
                 }
@@ -562,45 +1334,90 @@ int main()
                     glEnable(GL_CULL_FACE);
                     glFrontFace(GL_CCW);
                 }
-                glDrawElements(GL_TRIANGLES, g_meshes[i].vertexCount, GL_UNSIGNED_INT, 0);
+                uint32_t drawnIndices = DrawMeshlets(g_basicProgram, g_meshes[i], [&](const Meshlet& meshlet) {
+                    if (!g_settings.meshletCulling) {
+                        return true;
+                    }
+                    return IsSphereInFrustum(frustumPlanes, meshlet.boundingSphere) &&
+                           (mat.twoSided || !IsMeshletBackfacing(meshlet, eye));
+                });
+                stats.indexBytes[slot] += uint64_t{ drawnIndices } * 
+                    ((g_settings.packedVertices && g_meshes[i].packedIndexType == GL_UNSIGNED_SHORT) ? 2 : 4);
+            }
+
+            glEndQuery(GL_VERTEX_SHADER_INVOCATIONS);
+
+            // Every vertex shader invocation is a post-transform cache miss and fetches one vertex
+            uint32_t prevSlot = (stats.frame + 1) % 2;
+            GLuint available = 0;
+            if (stats.pending[prevSlot]) {
+                glGetQueryObjectuiv(stats.queries[prevSlot], GL_QUERY_RESULT_AVAILABLE, &available);
             }
+            if (available) {
+                glGetQueryObjectui64v(stats.queries[prevSlot], GL_QUERY_RESULT, &stats.lastVertexInvocations);
+                stats.lastVertexBytes = stats.lastVertexInvocations * stats.vertexStride[prevSlot];
+                stats.lastIndexBytes = stats.indexBytes[prevSlot];
+                stats.pending[prevSlot] = false;
+            }
+            ++stats.frame;
+        }
+
+        if (diffuseGI) {
+            PROFILE_SCOPE("Diffuse GI");
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, windowWidth, windowHeight);
+            g_voxelMipmap.Bind();
+            g_diffuseGI.Apply(g_shaderCompiler, g_gpuTimers, proj * glm::inverse(g_camera.matrix), giQuality,
+                              g_settings.giStrength, g_settings.giIndirectOnly, genericDrawVao);
         }
 
-        if (g_settings.showVoxels) { // draw voxelized scene
+        if (g_settings.showVoxels && sparseVoxels && g_shaderCompiler.IsReady(g_drawSvoProgram)) {
+            PROFILE_SCOPE("Draw SVO");
+            ScopedGpuTimer gpuTimer{ g_gpuTimers, "Draw SVO" };
+            glViewport(0, 0, windowWidth, windowHeight);
+            glDisable(GL_CULL_FACE);
+            glEnable(GL_DEPTH_TEST);
+            glUseProgram(g_drawSvoProgram);
+            g_svo.Bind();
+            glBindVertexArray(genericDrawVao);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+        else if (g_settings.showVoxels && !sparseVoxels && g_shaderCompiler.IsReady(g_drawVoxelsProgram)) { // draw voxelized scene
+            PROFILE_SCOPE("Draw voxels");
+            ScopedGpuTimer gpuTimer{ g_gpuTimers, "Draw voxels" };
 			glViewport(0, 0, windowWidth, windowHeight);
             // glEnable(GL_CULL_FACE);
             glEnable(GL_DEPTH_TEST);
-			glProgramUniform3fv(g_drawVoxelsProgram, glGetUniformLocation(g_drawVoxelsProgram, "u_sceneAABB"), 2, glm::value_ptr(g_sceneAABB[0]));
-			glProgramUniform1ui(g_drawVoxelsProgram, glGetUniformLocation(g_drawVoxelsProgram, "u_voxelResolution"), VOXEL_RESOLUTION);
-			glProgramUniformMatrix4fv(g_drawVoxelsProgram, glGetUniformLocation(g_drawVoxelsProgram, "u_proj"), 1, GL_FALSE, glm::value_ptr(proj));
-			glProgramUniformMatrix4fv(g_drawVoxelsProgram, glGetUniformLocation(g_drawVoxelsProgram, "u_view"), 1, GL_FALSE, glm::value_ptr(glm::inverse(g_camera.matrix)));
             glUseProgram(g_drawVoxelsProgram);
 			glBindImageTexture(VOXEL_IMAGE_BINDING, g_voxelTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+            g_voxelMipmap.Bind();
+            // A level of the mip volume instead when one is selected, one point per voxel of it
+            const int shownLevel = std::min(g_settings.shownVoxelLevel, static_cast<int>(g_voxelMipmap.LevelCount()) - 1);
+            const GLsizei resolution = (shownLevel < 0) ? VOXEL_RESOLUTION : (VOXEL_MIP_RESOLUTION >> shownLevel);
+            glProgramUniform1i(g_drawVoxelsProgram, UniformLocation(g_drawVoxelsProgram, "u_mipLevel"), shownLevel);
+            glProgramUniform1i(g_drawVoxelsProgram, UniformLocation(g_drawVoxelsProgram, "u_mipDirection"), g_settings.shownVoxelDirection);
             glBindVertexArray(genericDrawVao);
-            glDrawArrays(GL_POINTS, 0, VOXEL_RESOLUTION * VOXEL_RESOLUTION * VOXEL_RESOLUTION);
+            glDrawArrays(GL_POINTS, 0, resolution * resolution * resolution);
         }
 
-        if (g_settings.showAABB) {
+        if (g_settings.showAABB && g_shaderCompiler.IsReady(g_drawAABBProgram)) {
+            ScopedGpuTimer gpuTimer{ g_gpuTimers, "Draw AABB" };
 			glViewport(0, 0, windowWidth, windowHeight);
             glEnable(GL_CULL_FACE);
             glDisable(GL_DEPTH_TEST);
-			glProgramUniform3fv(g_drawAABBProgram, glGetUniformLocation(g_drawAABBProgram, "u_sceneAABB"), 2, glm::value_ptr(g_sceneAABB[0]));
-			glProgramUniformMatrix4fv(g_drawAABBProgram, glGetUniformLocation(g_drawAABBProgram, "u_proj"), 1, GL_FALSE, glm::value_ptr(proj));
-			glProgramUniformMatrix4fv(g_drawAABBProgram, glGetUniformLocation(g_drawAABBProgram, "u_view"), 1, GL_FALSE, glm::value_ptr(glm::inverse(g_camera.matrix)));
             glUseProgram(g_drawAABBProgram);
             glBindVertexArray(genericDrawVao);
             glDrawArrays(GL_LINES, 0, 24);
         }
 
-        if (g_settings.showAxes) {
+        if (g_settings.showAxes && g_shaderCompiler.IsReady(g_drawAxesProgram)) {
+            ScopedGpuTimer gpuTimer{ g_gpuTimers, "Draw axes" };
 			glViewport(0, 0, windowWidth, windowHeight);
             GLfloat lineWidth;
             glGetFloatv(GL_LINE_WIDTH, &lineWidth);
             glLineWidth(5.f);
             glDisable(GL_CULL_FACE);
             glDisable(GL_DEPTH_TEST);
-			glProgramUniformMatrix4fv(g_drawAxesProgram, glGetUniformLocation(g_drawAxesProgram, "u_proj"), 1, GL_FALSE, glm::value_ptr(proj));
-			glProgramUniformMatrix4fv(g_drawAxesProgram, glGetUniformLocation(g_drawAxesProgram, "u_view"), 1, GL_FALSE, glm::value_ptr(glm::inverse(g_camera.matrix)));
             glUseProgram(g_drawAxesProgram);
             glBindVertexArray(genericDrawVao);
             glDrawArrays(GL_LINES, 0, 6);
@@ -613,6 +1430,91 @@ int main()
         ImGui::Checkbox("Show voxels", &g_settings.showVoxels);
         ImGui::Checkbox("Show AABB", &g_settings.showAABB);
         ImGui::Checkbox("Show axes", &g_settings.showAxes);
+        ImGui::Checkbox("Packed vertices", &g_settings.packedVertices);
+        ImGui::Text("Vertex fetch: %.2f MB (%llu verts)", g_fetchStats.lastVertexBytes / (1024.f * 1024.f),
+                    static_cast<unsigned long long>(g_fetchStats.lastVertexInvocations));
+        ImGui::Text("Index fetch: %.2f MB", g_fetchStats.lastIndexBytes / (1024.f * 1024.f));
+        ImGui::Checkbox("Meshlet culling", &g_settings.meshletCulling);
+        ImGui::Text("Meshlets: %u/%u, draws: %u", g_cullStats.meshletsDrawn, g_cullStats.meshletsTested, g_cullStats.drawCommands);
+        const auto& uploadStats = g_uploadRing.Stats();
+        ImGui::Text("Uploads: %.2f MB/frame, stall %.2f ms (total %.1f ms, %u stalls)", uploadStats.frameBytes / (1024.f * 1024.f),
+                    uploadStats.frameStallMs, uploadStats.totalStallMs, uploadStats.stallCount);
+        if (g_shaderCompiler.PendingCount() > 0) {
+            ImGui::Text("Compiling %u programs", g_shaderCompiler.PendingCount());
+        }
+        if (g_shaderCompiler.HasErrors()) {
+            g_shaderCompiler.DrawErrors();
+        }
+        // The load task fills the texture list until it publishes ready
+        if (!g_stream.ready.load(std::memory_order_acquire)) {
+            ImGui::Text("Loading scene");
+        }
+        else if (!g_stream.done) {
+            ImGui::Text("Streaming: %u meshes, %u/%u textures", static_cast<uint32_t>(g_meshes.size()), 
+                        g_textureStreamer.UploadedCount(), g_textureStreamer.UniqueCount());
+        }
+        ImGui::Checkbox("Voxelize every frame", &g_settings.voxelizeEveryFrame);
+        ImGui::Text("Voxelizations: %u", g_voxelizeCount);
+        ImGui::Checkbox("Sparse voxel octree", &g_settings.sparseVoxels);
+        if (g_settings.sparseVoxels || !g_settings.computeVoxelizer) {
+            ImGui::Checkbox("Geometry shader voxelizer (baseline)", &g_settings.gsVoxelizer);
+        }
+        if (g_settings.sparseVoxels) {
+            if (ImGui::CollapsingHeader("Sparse voxel octree")) {
+                g_svo.Draw();
+            }
+        }
+        else {
+            ImGui::Checkbox("Compute voxelizer", &g_settings.computeVoxelizer);
+            if (g_settings.computeVoxelizer && ImGui::CollapsingHeader("Compute voxelizer")) {
+                g_computeVoxelizer.Draw();
+            }
+            ImGui::Checkbox("Voxel stats", &g_settings.voxelStats);
+            if (g_settings.voxelStats && ImGui::CollapsingHeader("Voxelization")) {
+                g_voxelStats.Draw();
+            }
+            if (ImGui::CollapsingHeader("Voxel mipmap")) {
+                ImGui::SliderInt("Levels per dispatch", &g_settings.mipLevelsPerDispatch, 1, VoxelMipmap::MAX_LEVELS_PER_DISPATCH);
+                ImGui::Checkbox("Refilter dirty region only", &g_settings.refilterDirtyRegion);
+                ImGui::SliderInt("Shown level", &g_settings.shownVoxelLevel, -1, static_cast<int>(g_voxelMipmap.LevelCount()) - 1,
+                                 g_settings.shownVoxelLevel < 0 ? "base" : "%d");
+                const char* directions[] = { "+X", "-X", "+Y", "-Y", "+Z", "-Z" };
+                ImGui::Combo("Shown direction", &g_settings.shownVoxelDirection, directions, IM_ARRAYSIZE(directions));
+                g_voxelMipmap.Draw();
+            }
+            ImGui::Checkbox("Diffuse GI", &g_settings.diffuseGI);
+            if (g_settings.diffuseGI && ImGui::CollapsingHeader("Diffuse GI")) {
+                const char* qualities[DiffuseGI::QUALITY_COUNT];
+                for (uint32_t i = 0; i < DiffuseGI::QUALITY_COUNT; ++i) {
+                    qualities[i] = DiffuseGI::QUALITIES[i].name;
+                }
+                const auto& quality = DiffuseGI::QUALITIES[g_settings.giQuality];
+                ImGui::Combo("Quality", &g_settings.giQuality, qualities, DiffuseGI::QUALITY_COUNT);
+                ImGui::SameLine();
+                ImGui::Text("%.2f ms at 1080p", g_diffuseGI.Cost1080pMs(g_gpuTimers, g_settings.giQuality));
+                ImGui::Text("%u cones, step %.2f, %.0f voxels", quality.coneCount, quality.stepSize, quality.maxDistance);
+                ImGui::RadioButton("Half resolution", &g_settings.giDownscale, 2);
+                ImGui::SameLine();
+                ImGui::RadioButton("Quarter resolution", &g_settings.giDownscale, 4);
+                ImGui::SliderFloat("Strength", &g_settings.giStrength, 0.f, 4.f);
+                ImGui::Checkbox("Indirect only", &g_settings.giIndirectOnly);
+                ImGui::Checkbox("Render at 1080p", &g_settings.giAt1080p);
+                if (g_diffuseGI.IsCreated()) {
+                    g_diffuseGI.Draw(g_gpuTimers, g_settings.giQuality);
+                }
+            }
+        }
+        if (ImGui::CollapsingHeader("GPU passes")) {
+            g_gpuTimers.DrawTable();
+        }
+#if VCT_PROFILER
+        if (ImGui::CollapsingHeader("CPU profiler")) {
+            if (ImGui::Button("Save Chrome trace")) {
+                Profiler::WriteChromeTrace(TRACE_PATH);
+            }
+            Profiler::DrawFlameView();
+        }
+#endif
         ImGui::End();
 
         /******************************************** END   DRAW ********************************************/
@@ -620,13 +1522,45 @@ int main()
 		ImGuiIO& io = ImGui::GetIO();
 		io.DisplaySize = ImVec2(windowWidth, windowHeight);
 
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            PROFILE_SCOPE("ImGui render");
+            ScopedGpuTimer gpuTimer{ g_gpuTimers, "ImGui" };
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
 
         // Swap the screen buffers
-        glfwSwapBuffers(g_window);
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(g_window);
+        }
         glfwPollEvents();
+        g_uploadRing.EndFrame();
+
+        if (g_stream.firstFrameMs == 0) {
+            g_stream.firstFrameMs = std::chrono::duration_cast<std::chrono::microseconds>(
+                SceneStream::Clock::now() - g_stream.start).count() / 1000.f;
+            std::cout << "Time to first frame: " << g_stream.firstFrameMs << " ms\n";
+        }
+    }
+
+    // The load task may still be importing and would start the streamer afterwards, wait for it before
+    // draining the streamer and tearing down what either of them writes to
+    g_stream.cancel.store(true, std::memory_order_relaxed);
+    if (g_stream.loadTask.valid()) {
+        g_stream.loadTask.wait();
+    }
+    g_textureStreamer.Cancel();
+    g_uploadRing.Destroy();
+    g_gpuTimers.Destroy();
+    if (!g_voxelStats.Runs().empty() && g_voxelStats.WriteCsv(VOXEL_STATS_PATH)) {
+        std::cout << "Voxel stats of " << g_voxelStats.Runs().size() << " runs written to " << VOXEL_STATS_PATH << '\n';
     }
+    g_voxelStats.Destroy();
+    g_svo.Destroy();
+    g_computeVoxelizer.Destroy();
+    g_voxelMipmap.Destroy();
+    g_diffuseGI.Destroy();
 
     ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
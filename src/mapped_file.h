@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+    bool IsOpen() const { return m_data != nullptr; }
+
+private:
+    const uint8_t* m_data{ nullptr };
+    size_t m_size{ 0 };
+#ifdef _WIN32
+    void* m_file{ nullptr };
+    void* m_mapping{ nullptr };
+#endif
+};
@@ -0,0 +1,350 @@
+#include "mesh_optimizer.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+
+// FIFO post-transform cache simulation
+struct CacheSimulator
+{
+    std::vector<uint32_t> timestamps;
+    uint32_t time{ 0 };
+    uint32_t cacheSize{ 0 };
+
+    CacheSimulator(size_t vertexCount, uint32_t size)
+        : timestamps(vertexCount, 0)
+        , time(size + 1)
+        , cacheSize(size)
+    {
+    }
+
+    // Returns true on a miss
+    bool Access(uint32_t v)
+    {
+        if (time - timestamps[v] > cacheSize) {
+            timestamps[v] = time++;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Vertex to triangle adjacency in CSR form
+struct Adjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    Adjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+        : offsets(vertexCount + 1, 0)
+        , triangles(indexCount)
+    {
+        for (size_t i = 0; i < indexCount; ++i) {
+            ++offsets[indices[i] + 1];
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indexCount; ++i) {
+            triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+};
+
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    if (indexCount == 0) {
+        return stats;
+    }
+
+    CacheSimulator cache{ vertexCount, cacheSize };
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0, uniqueVertices = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        misses += cache.Access(indices[i]);
+        if (!referenced[indices[i]]) {
+            referenced[indices[i]] = true;
+            ++uniqueVertices;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / (indexCount / 3);
+    stats.atvr = static_cast<float>(misses) / uniqueVertices;
+    return stats;
+}
+
+/* Tipsify: fan around the most recently cached vertex that still has live triangles, 
+ * fall back to a dead-end stack of recently emitted vertices, then to input order */
+void OptimizeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                         uint32_t* outIndices, uint32_t cacheSize)
+{
+    if (indexCount == 0) {
+        return;
+    }
+
+    const size_t triangleCount = indexCount / 3;
+    Adjacency adjacency{ indices, indexCount, vertexCount };
+
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    deadEnd.reserve(indexCount);
+
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0; // next vertex in input order to try when the dead-end stack is empty
+    size_t written = 0;
+    int64_t fan = indices[0];
+
+    while (fan >= 0) {
+        candidates.clear();
+        for (uint32_t a = adjacency.offsets[fan]; a < adjacency.offsets[fan + 1]; ++a) {
+            uint32_t t = adjacency.triangles[a];
+            if (emitted[t]) {
+                continue;
+            }
+            for (uint32_t k = 0; k < 3; ++k) {
+                uint32_t v = indices[3 * t + k];
+                outIndices[written++] = v;
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // Prefer the candidate that stays in the cache long enough to emit all of its triangles
+        int64_t next = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (liveTriangles[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if (next < 0) {
+            while (!deadEnd.empty()) {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0) {
+                    next = v;
+                    break;
+                }
+            }
+        }
+        while (next < 0 && cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) {
+                next = static_cast<int64_t>(cursor);
+            }
+            ++cursor;
+        }
+
+        fan = next;
+    }
+}
+
+/* Split the cache-optimized sequence into clusters at points where the cache restarts or where the
+ * running ACMR of the cluster is low enough, then sort the clusters so that the ones facing away
+ * from the mesh center, which are likely to occlude the rest, are drawn first */
+void OptimizeOverdraw(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                      uint32_t* outIndices, float threshold, uint32_t cacheSize)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Hard boundaries: triangles that miss the cache on all three vertices
+    std::vector<uint32_t> hardClusters;
+    std::vector<uint32_t> triangleMisses(triangleCount);
+    {
+        CacheSimulator cache{ vertexCount, cacheSize };
+        for (size_t t = 0; t < triangleCount; ++t) {
+            uint32_t misses = cache.Access(indices[3 * t]) + cache.Access(indices[3 * t + 1]) + cache.Access(indices[3 * t + 2]);
+            triangleMisses[t] = misses;
+            if (misses == 3) {
+                hardClusters.push_back(static_cast<uint32_t>(t));
+            }
+        }
+        if (hardClusters.empty() || hardClusters[0] != 0) {
+            hardClusters.insert(hardClusters.begin(), 0);
+        }
+    }
+
+    // Soft boundaries inside each hard cluster
+    std::vector<uint32_t> clusters;
+    for (size_t c = 0; c < hardClusters.size(); ++c) {
+        uint32_t begin = hardClusters[c];
+        uint32_t end = (c + 1 < hardClusters.size()) ? hardClusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; ++t) {
+            clusterMisses += triangleMisses[t];
+        }
+        float clusterACMR = static_cast<float>(clusterMisses) / (end - begin);
+
+        clusters.push_back(begin);
+        uint32_t runningMisses = 0, runningTriangles = 0;
+        for (uint32_t t = begin; t < end; ++t) {
+            runningMisses += triangleMisses[t];
+            ++runningTriangles;
+            if (t + 1 < end && runningTriangles >= 8 && 
+                static_cast<float>(runningMisses) / runningTriangles <= clusterACMR * threshold) {
+                clusters.push_back(t + 1);
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+
+    glm::vec3 meshCenter{ 0 };
+    float meshArea = 0;
+    struct ClusterKey
+    {
+        uint32_t begin;
+        uint32_t end;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float sortKey;
+    };
+    std::vector<ClusterKey> keys(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        auto& key = keys[c];
+        key.begin = clusters[c];
+        key.end = (c + 1 < clusters.size()) ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+        key.centroid = glm::vec3{ 0 };
+        key.normal = glm::vec3{ 0 };
+
+        float area = 0;
+        for (uint32_t t = key.begin; t < key.end; ++t) {
+            const auto& p0 = vertices[indices[3 * t]].position;
+            const auto& p1 = vertices[indices[3 * t + 1]].position;
+            const auto& p2 = vertices[indices[3 * t + 2]].position;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+            float a = glm::length(n);
+            key.centroid += (p0 + p1 + p2) * (a / 3);
+            key.normal += n;
+            area += a;
+        }
+        meshCenter += key.centroid;
+        meshArea += area;
+        key.centroid = (area > 0) ? key.centroid / area : vertices[indices[3 * key.begin]].position;
+        float len = glm::length(key.normal);
+        key.normal = (len > 0) ? key.normal / len : glm::vec3{ 0 };
+    }
+    meshCenter = (meshArea > 0) ? meshCenter / meshArea : glm::vec3{ 0 };
+
+    for (auto& key : keys) {
+        key.sortKey = glm::dot(key.centroid - meshCenter, key.normal);
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const ClusterKey& a, const ClusterKey& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    size_t written = 0;
+    for (const auto& key : keys) {
+        for (uint32_t t = key.begin; t < key.end; ++t) {
+            outIndices[written++] = indices[3 * t];
+            outIndices[written++] = indices[3 * t + 1];
+            outIndices[written++] = indices[3 * t + 2];
+        }
+    }
+}
+
+size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                           Vertex* outVertices)
+{
+    constexpr uint32_t UNMAPPED = ~0u;
+    std::vector<uint32_t> remap(vertexCount, UNMAPPED);
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t& mapped = remap[indices[i]];
+        if (mapped == UNMAPPED) {
+            outVertices[next] = vertices[indices[i]];
+            mapped = next++;
+        }
+        indices[i] = mapped;
+    }
+    return next;
+}
+
+void OptimizeScene(SceneData& scene)
+{
+    PROFILE_FUNCTION();
+    const size_t meshCount = scene.meshes.size();
+    std::vector<VertexCacheStats> before(meshCount), after(meshCount);
+    std::vector<std::vector<Vertex>> meshVertices(meshCount);
+
+    // Meshes are independent, vertices are compacted into the shared array afterwards
+    GetThreadPool().ParallelFor(static_cast<uint32_t>(meshCount), [&](uint32_t i) {
+        const auto& mesh = scene.meshes[i];
+        uint32_t* indices = scene.indices.data() + mesh.firstIndex;
+        const Vertex* vertices = scene.vertices.data() + mesh.firstVertex;
+
+        before[i] = AnalyzeVertexCache(indices, mesh.indexCount, mesh.vertexCount);
+
+        std::vector<uint32_t> cacheOptimized(mesh.indexCount);
+        OptimizeVertexCache(indices, mesh.indexCount, mesh.vertexCount, cacheOptimized.data());
+        OptimizeOverdraw(cacheOptimized.data(), mesh.indexCount, vertices, mesh.vertexCount, indices);
+
+        meshVertices[i].resize(mesh.vertexCount);
+        size_t used = OptimizeVertexFetch(indices, mesh.indexCount, vertices, mesh.vertexCount, meshVertices[i].data());
+        meshVertices[i].resize(used);
+
+        after[i] = AnalyzeVertexCache(indices, mesh.indexCount, used);
+    });
+
+    std::vector<Vertex> vertices;
+    vertices.reserve(scene.vertices.size());
+    for (size_t i = 0; i < meshCount; ++i) {
+        auto& mesh = scene.meshes[i];
+        mesh.firstVertex = static_cast<uint32_t>(vertices.size());
+        mesh.vertexCount = static_cast<uint32_t>(meshVertices[i].size());
+        vertices.insert(vertices.end(), meshVertices[i].begin(), meshVertices[i].end());
+    }
+    scene.vertices = std::move(vertices);
+
+    std::cout << "--- Mesh optimization (FIFO " << VERTEX_CACHE_SIZE << ") ---\n";
+    std::cout << " mesh  triangles   ACMR before/after   ATVR before/after\n";
+    double weightedBefore = 0, weightedAfter = 0;
+    size_t totalTriangles = 0;
+    for (size_t i = 0; i < meshCount; ++i) {
+        uint32_t triangles = scene.meshes[i].indexCount / 3;
+        char line[128];
+        std::snprintf(line, sizeof(line), "%5zu %10u   %6.3f / %6.3f     %6.3f / %6.3f\n", 
+                      i, triangles, before[i].acmr, after[i].acmr, before[i].atvr, after[i].atvr);
+        std::cout << line;
+        weightedBefore += double{ before[i].acmr } * triangles;
+        weightedAfter += double{ after[i].acmr } * triangles;
+        totalTriangles += triangles;
+    }
+    if (totalTriangles > 0) {
+        std::cout << "Scene ACMR: " << weightedBefore / totalTriangles << " -> " << weightedAfter / totalTriangles << '\n';
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "scene.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/* Load-time mesh optimization, all indices are relative to the mesh
+ * 1. Reorder triangles for the post-transform vertex cache (Tipsify)
+ * 2. Reorder clusters of triangles to reduce overdraw (Sander et al. 2007)
+ * 3. Reorder vertices into fetch order
+ */
+
+// FIFO size used by the optimizer and by the statistics
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats
+{
+    float acmr{ 0 }; // cache misses per triangle, 0.5 is the optimum for regular grids
+    float atvr{ 0 }; // cache misses per referenced vertex, 1.0 is the optimum
+};
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                    uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+void OptimizeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                         uint32_t* outIndices, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// indices must already be optimized for the vertex cache, threshold > 1 trades cache efficiency for less overdraw
+void OptimizeOverdraw(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                      uint32_t* outIndices, float threshold = 1.05f, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Rewrites indices in place, returns the number of referenced vertices written to outVertices
+size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                           Vertex* outVertices);
+
+// Run all stages on every mesh of the scene and print per-mesh statistics
+void OptimizeScene(SceneData& scene);
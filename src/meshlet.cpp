@@ -0,0 +1,189 @@
+#include "meshlet.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+
+// Bounds and normal cone of the triangles [begin, end) of a mesh
+void ComputeBounds(const uint32_t* indices, size_t begin, size_t end, const Vertex* vertices, Meshlet& meshlet)
+{
+    glm::vec3 aabbMin{ std::numeric_limits<float>::max() };
+    glm::vec3 aabbMax{ std::numeric_limits<float>::lowest() };
+    for (size_t i = begin; i < end; ++i) {
+        const auto& p = vertices[indices[i]].position;
+        aabbMin = glm::min(aabbMin, p);
+        aabbMax = glm::max(aabbMax, p);
+    }
+
+    glm::vec3 center = 0.5f * (aabbMin + aabbMax);
+    float radius = 0;
+    for (size_t i = begin; i < end; ++i) {
+        radius = std::max(radius, glm::length(vertices[indices[i]].position - center));
+    }
+
+    struct TrianglePlane
+    {
+        glm::vec3 point;
+        glm::vec3 normal;
+    };
+    std::vector<TrianglePlane> planes;
+    planes.reserve((end - begin) / 3);
+    glm::vec3 axis{ 0 };
+    for (size_t i = begin; i < end; i += 3) {
+        const auto& p0 = vertices[indices[i]].position;
+        const auto& p1 = vertices[indices[i + 1]].position;
+        const auto& p2 = vertices[indices[i + 2]].position;
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        float len = glm::length(n);
+        if (len > 0) {
+            planes.push_back({ p0, n / len });
+            axis += n / len;
+        }
+    }
+
+    meshlet.boundingSphere = glm::vec4(center, radius);
+    meshlet.aabbMin = glm::vec4(aabbMin, 1);
+    meshlet.aabbMax = glm::vec4(aabbMax, 1);
+
+    // Cone culling is disabled when the normals spread over more than a hemisphere
+    float axisLen = glm::length(axis);
+    float minDot = 1;
+    if (axisLen > 0) {
+        axis /= axisLen;
+        for (const auto& plane : planes) {
+            minDot = std::min(minDot, glm::dot(axis, plane.normal));
+        }
+    }
+    if (axisLen == 0 || minDot <= 0.1f) {
+        meshlet.coneApex = glm::vec4(center, 1);
+        meshlet.coneAxisCutoff = glm::vec4(0, 0, 1, 2);
+        return;
+    }
+
+    // Move the apex back along the axis until every triangle plane is in front of it
+    float maxT = 0;
+    for (const auto& plane : planes) {
+        float t = glm::dot(center - plane.point, plane.normal) / glm::dot(axis, plane.normal);
+        maxT = std::max(maxT, t);
+    }
+
+    meshlet.coneApex = glm::vec4(center - axis * maxT, 1);
+    meshlet.coneAxisCutoff = glm::vec4(axis, std::sqrt(1 - minDot * minDot));
+}
+
+}
+
+void BuildMeshlets(const uint32_t* indices, size_t indexCount, const Vertex* vertices,
+                   uint32_t firstIndex, uint32_t baseVertex, uint32_t meshIndex, std::vector<Meshlet>& outMeshlets)
+{
+    // Vertices of the current meshlet, small enough for a linear search
+    uint32_t meshletVertices[MESHLET_MAX_VERTICES];
+    uint32_t vertexCount = 0;
+    size_t begin = 0;
+
+    auto Flush = [&](size_t end) {
+        if (end == begin) {
+            return;
+        }
+        Meshlet meshlet;
+        meshlet.firstIndex = firstIndex + static_cast<uint32_t>(begin);
+        meshlet.indexCount = static_cast<uint32_t>(end - begin);
+        meshlet.baseVertex = baseVertex;
+        meshlet.meshIndex = meshIndex;
+        ComputeBounds(indices, begin, end, vertices, meshlet);
+        outMeshlets.push_back(meshlet);
+        begin = end;
+        vertexCount = 0;
+    };
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        uint32_t newVertices[3];
+        uint32_t newCount = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            uint32_t v = indices[i + k];
+            bool found = std::find(meshletVertices, meshletVertices + vertexCount, v) != meshletVertices + vertexCount ||
+                         std::find(newVertices, newVertices + newCount, v) != newVertices + newCount;
+            if (!found) {
+                newVertices[newCount++] = v;
+            }
+        }
+
+        if (vertexCount + newCount > MESHLET_MAX_VERTICES || (i - begin) / 3 + 1 > MESHLET_MAX_TRIANGLES) {
+            Flush(i);
+            // All vertices of the triangle are new to the next meshlet
+            newCount = 0;
+            for (uint32_t k = 0; k < 3; ++k) {
+                uint32_t v = indices[i + k];
+                if (std::find(newVertices, newVertices + newCount, v) == newVertices + newCount) {
+                    newVertices[newCount++] = v;
+                }
+            }
+        }
+
+        for (uint32_t k = 0; k < newCount; ++k) {
+            meshletVertices[vertexCount++] = newVertices[k];
+        }
+    }
+    Flush(indexCount - indexCount % 3);
+}
+
+void BuildSceneMeshlets(SceneData& scene)
+{
+    PROFILE_FUNCTION();
+    scene.meshlets.clear();
+    for (uint32_t i = 0; i < scene.meshes.size(); ++i) {
+        auto& mesh = scene.meshes[i];
+        mesh.firstMeshlet = static_cast<uint32_t>(scene.meshlets.size());
+        BuildMeshlets(scene.indices.data() + mesh.firstIndex, mesh.indexCount, 
+                      scene.vertices.data() + mesh.firstVertex,
+                      mesh.firstIndex, mesh.firstVertex, i, scene.meshlets);
+        mesh.meshletCount = static_cast<uint32_t>(scene.meshlets.size()) - mesh.firstMeshlet;
+    }
+
+    std::cout << "Meshlets: " << scene.meshlets.size() << " (" << MESHLET_MAX_VERTICES << " vertices, " 
+        << MESHLET_MAX_TRIANGLES << " triangles max)\n";
+}
+
+void ExtractFrustumPlanes(const glm::mat4& viewProj, glm::vec4 outPlanes[6])
+{
+    // Gribb-Hartmann, rows of the matrix
+    glm::vec4 row[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+        row[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+    }
+
+    outPlanes[0] = row[3] + row[0];
+    outPlanes[1] = row[3] - row[0];
+    outPlanes[2] = row[3] + row[1];
+    outPlanes[3] = row[3] - row[1];
+    outPlanes[4] = row[3] + row[2];
+    outPlanes[5] = row[3] - row[2];
+    for (uint32_t i = 0; i < 6; ++i) {
+        outPlanes[i] /= glm::length(glm::vec3(outPlanes[i]));
+    }
+}
+
+bool IsSphereInFrustum(const glm::vec4 planes[6], const glm::vec4& sphere)
+{
+    for (uint32_t i = 0; i < 6; ++i) {
+        if (glm::dot(glm::vec3(planes[i]), glm::vec3(sphere)) + planes[i].w < -sphere.w) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& eye)
+{
+    glm::vec3 dir = glm::vec3(meshlet.coneApex) - eye;
+    float len = glm::length(dir);
+    if (len == 0) {
+        return false;
+    }
+    return glm::dot(dir / len, glm::vec3(meshlet.coneAxisCutoff)) >= meshlet.coneAxisCutoff.w;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "scene.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+/* Meshlet generation
+ * Triangles are consumed in index order and a new meshlet starts when either limit would be exceeded.
+ * Run after the vertex cache optimization, whose ordering already keeps neighbouring triangles together.
+ */
+void BuildMeshlets(const uint32_t* indices, size_t indexCount, const Vertex* vertices, 
+                   uint32_t firstIndex, uint32_t baseVertex, uint32_t meshIndex, std::vector<Meshlet>& outMeshlets);
+
+// Fill SceneData::meshlets and the meshlet ranges of every mesh record
+void BuildSceneMeshlets(SceneData& scene);
+
+/* Culling */
+
+// Planes point inwards, xyz normal and w distance
+void ExtractFrustumPlanes(const glm::mat4& viewProj, glm::vec4 outPlanes[6]);
+
+bool IsSphereInFrustum(const glm::vec4 planes[6], const glm::vec4& sphere);
+
+// True when every triangle of the meshlet faces away from the eye
+bool IsMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& eye);
@@ -0,0 +1,210 @@
+#include "mip_generator.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+// Rows per job when filtering a level
+constexpr uint32_t ROWS_PER_JOB = 32;
+
+float SRGBToLinear(float c)
+{
+    return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSRGB(float c)
+{
+    return (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+}
+
+struct DecodeTable
+{
+    float srgb[256];
+
+    DecodeTable()
+    {
+        for (uint32_t i = 0; i < 256; ++i) {
+            srgb[i] = SRGBToLinear(i / 255.f);
+        }
+    }
+};
+
+const DecodeTable& GetDecodeTable()
+{
+    static const DecodeTable table;
+    return table;
+}
+
+// Level data in filter space, four floats per texel
+struct FloatLevel
+{
+    uint32_t width{ 0 };
+    uint32_t height{ 0 };
+    std::vector<float> texels;
+};
+
+void Decode(const uint8_t* rgba, uint32_t width, uint32_t height, MipFilter filter, FloatLevel& out)
+{
+    const auto& table = GetDecodeTable();
+    out.width = width;
+    out.height = height;
+    out.texels.resize(size_t{ 4 } * width * height);
+    for (size_t i = 0; i < size_t{ width } * height; ++i) {
+        for (uint32_t k = 0; k < 4; ++k) {
+            uint8_t v = rgba[4 * i + k];
+            out.texels[4 * i + k] = (filter == MipFilter::SRGB && k < 3) ? table.srgb[v] :
+                                    (filter == MipFilter::Normal && k < 3) ? v / 127.5f - 1.f :
+                                    v / 255.f;
+        }
+    }
+}
+
+uint8_t Quantize(float v)
+{
+    return static_cast<uint8_t>(std::clamp(v, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+void Encode(const float* texel, MipFilter filter, float coverageScale, int32_t coverageChannel, uint8_t* out)
+{
+    for (uint32_t k = 0; k < 4; ++k) {
+        float v = texel[k];
+        if (static_cast<int32_t>(k) == coverageChannel) {
+            v *= coverageScale;
+        }
+        out[k] = (filter == MipFilter::SRGB && k < 3) ? Quantize(LinearToSRGB(v)) :
+                 (filter == MipFilter::Normal && k < 3) ? Quantize(v * 0.5f + 0.5f) :
+                 Quantize(v);
+    }
+}
+
+void Downsample(const FloatLevel& src, MipFilter filter, FloatLevel& dst)
+{
+    dst.width = std::max(1u, src.width / 2);
+    dst.height = std::max(1u, src.height / 2);
+    dst.texels.resize(size_t{ 4 } * dst.width * dst.height);
+
+    uint32_t jobs = (dst.height + ROWS_PER_JOB - 1) / ROWS_PER_JOB;
+    GetThreadPool().ParallelFor(jobs, [&](uint32_t job) {
+        uint32_t yEnd = std::min(dst.height, (job + 1) * ROWS_PER_JOB);
+        for (uint32_t y = job * ROWS_PER_JOB; y < yEnd; ++y) {
+            // Clamping covers the odd and 1-texel-wide cases
+            uint32_t y0 = std::min(2 * y, src.height - 1);
+            uint32_t y1 = std::min(2 * y + 1, src.height - 1);
+            for (uint32_t x = 0; x < dst.width; ++x) {
+                uint32_t x0 = std::min(2 * x, src.width - 1);
+                uint32_t x1 = std::min(2 * x + 1, src.width - 1);
+                const float* taps[4] = {
+                    &src.texels[4 * (size_t{ y0 } * src.width + x0)],
+                    &src.texels[4 * (size_t{ y0 } * src.width + x1)],
+                    &src.texels[4 * (size_t{ y1 } * src.width + x0)],
+                    &src.texels[4 * (size_t{ y1 } * src.width + x1)],
+                };
+
+                float* out = &dst.texels[4 * (size_t{ y } * dst.width + x)];
+                for (uint32_t k = 0; k < 4; ++k) {
+                    out[k] = 0.25f * (taps[0][k] + taps[1][k] + taps[2][k] + taps[3][k]);
+                }
+
+                if (filter == MipFilter::Normal) {
+                    float len = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+                    if (len > 1e-6f) {
+                        out[0] /= len;
+                        out[1] /= len;
+                        out[2] /= len;
+                    }
+                    else {
+                        out[0] = out[1] = 0;
+                        out[2] = 1;
+                    }
+                }
+            }
+        }
+    });
+}
+
+float Coverage(const FloatLevel& level, uint32_t channel, float ref, float scale)
+{
+    size_t covered = 0;
+    size_t count = size_t{ level.width } * level.height;
+    for (size_t i = 0; i < count; ++i) {
+        if (level.texels[4 * i + channel] * scale > ref) {
+            ++covered;
+        }
+    }
+    return static_cast<float>(covered) / count;
+}
+
+// Find the scale that brings the coverage of the level back to the target, see
+// "Computing Alpha Mipmaps" (Castano)
+float CoverageScale(const FloatLevel& level, uint32_t channel, float ref, float targetCoverage)
+{
+    float lo = 0.f, hi = 4.f;
+    float best = 1.f, bestError = std::abs(Coverage(level, channel, ref, 1.f) - targetCoverage);
+    for (uint32_t i = 0; i < 12; ++i) {
+        float mid = 0.5f * (lo + hi);
+        float coverage = Coverage(level, channel, ref, mid);
+        float error = std::abs(coverage - targetCoverage);
+        if (error < bestError) {
+            best = mid;
+            bestError = error;
+        }
+        if (coverage < targetCoverage) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return best;
+}
+
+}
+
+uint32_t MipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t count = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size /= 2) {
+        ++count;
+    }
+    return count;
+}
+
+std::vector<MipLevel> GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, const MipOptions& options)
+{
+    PROFILE_FUNCTION();
+    std::vector<MipLevel> levels(MipLevelCount(width, height));
+    levels[0].width = width;
+    levels[0].height = height;
+    levels[0].rgba.assign(rgba, rgba + size_t{ 4 } * width * height);
+
+    FloatLevel current, next;
+    Decode(rgba, width, height, options.filter, current);
+
+    const bool preserveCoverage = options.coverageChannel >= 0 && options.coverageChannel < 4;
+    const float targetCoverage = preserveCoverage ? 
+        Coverage(current, options.coverageChannel, options.coverageRef, 1.f) : 0.f;
+
+    for (uint32_t i = 1; i < levels.size(); ++i) {
+        // Always filter from the unscaled level so that coverage corrections do not accumulate
+        Downsample(current, options.filter, next);
+        std::swap(current, next);
+
+        float scale = preserveCoverage ?
+            CoverageScale(current, options.coverageChannel, options.coverageRef, targetCoverage) : 1.f;
+
+        auto& level = levels[i];
+        level.width = current.width;
+        level.height = current.height;
+        level.rgba.resize(size_t{ 4 } * level.width * level.height);
+        for (size_t j = 0; j < size_t{ level.width } * level.height; ++j) {
+            Encode(&current.texels[4 * j], options.filter, scale, options.coverageChannel, &level.rgba[4 * j]);
+        }
+    }
+
+    return levels;
+}
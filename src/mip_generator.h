@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class MipFilter
+{
+    Linear, // box filter on the stored values
+    SRGB,   // color channels are decoded to linear before filtering, alpha is linear
+    Normal, // RGB holds a unit vector, renormalized after filtering
+};
+
+struct MipOptions
+{
+    MipFilter filter{ MipFilter::Linear };
+    // Keep the fraction of texels above coverageRef in this channel constant over the chain, -1 disables
+    int32_t coverageChannel{ -1 };
+    float coverageRef{ 0.5f };
+};
+
+struct MipLevel
+{
+    uint32_t width{ 0 };
+    uint32_t height{ 0 };
+    std::vector<uint8_t> rgba;
+};
+
+uint32_t MipLevelCount(uint32_t width, uint32_t height);
+
+// Build the full chain down to 1x1 from an RGBA8 image, level 0 is a copy of the input.
+// Rows of each level are filtered in parallel on the thread pool.
+std::vector<MipLevel> GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, const MipOptions& options);
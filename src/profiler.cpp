@@ -0,0 +1,212 @@
+#include "profiler.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Profiler
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+const Clock::time_point g_epoch = Clock::now();
+
+// Events close to being overwritten are skipped by readers, the writer may be touching them
+constexpr uint32_t READ_MARGIN = 1024;
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadEvents>> threads;
+};
+
+Registry& GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+// Frame start times of the thread calling BeginFrame
+struct FrameHistory
+{
+    ThreadEvents* thread{ nullptr };
+    uint64_t starts[FRAME_HISTORY]{ 0 };
+    uint64_t count{ 0 };
+};
+FrameHistory g_frames;
+
+uint64_t FirstReadable(uint64_t count)
+{
+    constexpr uint64_t readable = EVENTS_PER_THREAD - READ_MARGIN;
+    return (count > readable) ? count - readable : 0;
+}
+
+void WriteJsonString(std::ostream& os, const char* str)
+{
+    os << '"';
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\') {
+            os << '\\';
+        }
+        os << *str;
+    }
+    os << '"';
+}
+
+ImU32 ZoneColor(const char* name)
+{
+    // Stable per call site, the names are string literals
+    uint32_t hash = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(name) >> 3) * 2654435761u;
+    return IM_COL32(80 + (hash >> 24) % 120, 80 + (hash >> 16) % 120, 80 + (hash >> 8) % 120, 255);
+}
+
+}
+
+uint64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - g_epoch).count();
+}
+
+ThreadEvents& RegisterThread()
+{
+    auto& registry = GetRegistry();
+    std::lock_guard lock{ registry.mutex };
+    registry.threads.push_back(std::make_unique<ThreadEvents>());
+    auto& thread = *registry.threads.back();
+    thread.id = static_cast<uint32_t>(registry.threads.size() - 1);
+    std::snprintf(thread.name, sizeof(thread.name), "Thread %u", thread.id);
+    t_currentThread = &thread;
+    return thread;
+}
+
+void SetThreadName(const char* name)
+{
+    auto& thread = CurrentThread();
+    std::lock_guard lock{ GetRegistry().mutex };
+    std::snprintf(thread.name, sizeof(thread.name), "%s %u", name, thread.id);
+}
+
+void BeginFrame()
+{
+    g_frames.thread = &CurrentThread();
+    g_frames.starts[g_frames.count % FRAME_HISTORY] = Now();
+    ++g_frames.count;
+}
+
+bool WriteChromeTrace(const std::filesystem::path& path)
+{
+    std::ofstream ofs{ path };
+    if (!ofs.is_open()) {
+        return false;
+    }
+
+    auto& registry = GetRegistry();
+    std::lock_guard lock{ registry.mutex };
+
+    char number[32];
+    auto Us = [&number](uint64_t ns) {
+        std::snprintf(number, sizeof(number), "%.3f", ns / 1000.0);
+        return number;
+    };
+
+    ofs << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& thread : registry.threads) {
+        ofs << (first ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << thread->id
+            << R"(,"args":{"name":)";
+        WriteJsonString(ofs, thread->name);
+        ofs << "}}";
+        first = false;
+
+        uint64_t count = thread->count.load(std::memory_order_acquire);
+        for (uint64_t i = FirstReadable(count); i < count; ++i) {
+            const auto& event = thread->events[i % EVENTS_PER_THREAD];
+            ofs << ",\n{\"name\":";
+            WriteJsonString(ofs, event.name);
+            ofs << R"(,"ph":"X","pid":0,"tid":)" << thread->id << ",\"ts\":" << Us(event.beginNs);
+            ofs << ",\"dur\":" << Us(event.endNs - event.beginNs) << '}';
+        }
+    }
+    ofs << "\n]}\n";
+    return ofs.good();
+}
+
+void DrawFlameView()
+{
+    static int framesAgo = 0;
+    static bool paused = false;
+    static std::vector<Event> zones;
+    static uint64_t frameBegin = 0, frameEnd = 0;
+
+    // The newest start belongs to the frame in progress
+    uint64_t completed = (g_frames.count > 0) ? std::min<uint64_t>(g_frames.count - 1, FRAME_HISTORY - 1) : 0;
+    if (completed == 0 || !g_frames.thread) {
+        ImGui::Text("No frame recorded yet");
+        return;
+    }
+
+    ImGui::Checkbox("Pause", &paused);
+    ImGui::SameLine();
+    ImGui::SliderInt("Frames ago", &framesAgo, 0, static_cast<int>(completed) - 1);
+
+    if (!paused) {
+        uint64_t frame = g_frames.count - 2 - framesAgo;
+        frameBegin = g_frames.starts[frame % FRAME_HISTORY];
+        frameEnd = g_frames.starts[(frame + 1) % FRAME_HISTORY];
+
+        // Events are stored in the order they ended, scan back until the frame start is passed
+        zones.clear();
+        const auto& thread = *g_frames.thread;
+        uint64_t count = thread.count.load(std::memory_order_acquire);
+        for (uint64_t i = count; i-- > FirstReadable(count);) {
+            const auto& event = thread.events[i % EVENTS_PER_THREAD];
+            if (event.endNs < frameBegin) {
+                break;
+            }
+            if (event.beginNs >= frameBegin && event.endNs <= frameEnd) {
+                zones.push_back(event);
+            }
+        }
+    }
+
+    uint32_t maxDepth = 0;
+    for (const auto& zone : zones) {
+        maxDepth = std::max(maxDepth, zone.depth);
+    }
+    const double frameNs = static_cast<double>(std::max<uint64_t>(frameEnd - frameBegin, 1));
+    ImGui::Text("Frame: %.3f ms, %u zones", frameNs / 1e6, static_cast<uint32_t>(zones.size()));
+
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.f;
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 size{ std::max(ImGui::GetContentRegionAvail().x, 100.f), rowHeight * (maxDepth + 1) };
+    ImGui::Dummy(size);
+
+    auto drawList = ImGui::GetWindowDrawList();
+    drawList->AddRect(origin, ImVec2{ origin.x + size.x, origin.y + size.y }, IM_COL32(128, 128, 128, 255));
+    for (const auto& zone : zones) {
+        float x0 = origin.x + static_cast<float>((zone.beginNs - frameBegin) / frameNs) * size.x;
+        float x1 = origin.x + static_cast<float>((zone.endNs - frameBegin) / frameNs) * size.x;
+        x1 = std::max(x1, x0 + 1.f);
+        float y0 = origin.y + zone.depth * rowHeight;
+        ImVec2 min{ x0, y0 }, max{ x1, y0 + rowHeight - 1.f };
+
+        drawList->AddRectFilled(min, max, ZoneColor(zone.name));
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2{ x0 + 2.f, y0 + 2.f }, IM_COL32(255, 255, 255, 255), zone.name);
+        drawList->PopClipRect();
+
+        if (ImGui::IsMouseHoveringRect(min, max)) {
+            ImGui::SetTooltip("%s: %.3f ms", zone.name, (zone.endNs - zone.beginNs) / 1e6);
+        }
+    }
+}
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+
+// Set to 0 to compile every PROFILE_* macro out
+#ifndef VCT_PROFILER
+#define VCT_PROFILER 1
+#endif
+
+/* Scoped-zone CPU profiler
+ * Every thread appends finished zones to its own ring of events, so recording takes no lock.
+ * Threads register their ring once on first use, readers only look at events below the published count.
+ */
+namespace Profiler
+{
+
+struct Event
+{
+    const char* name; // must have static storage duration
+    uint64_t beginNs;
+    uint64_t endNs;
+    uint32_t depth;
+};
+
+constexpr uint32_t EVENTS_PER_THREAD = 1 << 14;
+constexpr uint32_t FRAME_HISTORY = 128;
+
+struct ThreadEvents
+{
+    char name[32]{};
+    uint32_t id{ 0 };
+    uint32_t depth{ 0 };
+    std::atomic<uint64_t> count{ 0 }; // events ever written, the ring holds the last EVENTS_PER_THREAD
+    Event events[EVENTS_PER_THREAD];
+};
+
+// Nanoseconds since the profiler epoch, taken at static initialization
+uint64_t Now();
+
+// Registration takes the registry lock once per thread, lookups afterwards are a thread_local read
+ThreadEvents& RegisterThread();
+
+inline thread_local ThreadEvents* t_currentThread = nullptr;
+
+inline ThreadEvents& CurrentThread()
+{
+    return t_currentThread ? *t_currentThread : RegisterThread();
+}
+
+void SetThreadName(const char* name);
+
+// Marks the start of a frame on the calling thread, which is the one shown in the flame view
+void BeginFrame();
+
+// Chrome trace_event JSON of everything still held by the rings, open it in chrome://tracing or Perfetto
+bool WriteChromeTrace(const std::filesystem::path& path);
+
+// Flame graph of one of the last FRAME_HISTORY frames, draws into the current ImGui window
+void DrawFlameView();
+
+class ScopedZone
+{
+public:
+    explicit ScopedZone(const char* name)
+        : m_thread(CurrentThread()), m_name(name), m_depth(m_thread.depth++), m_begin(Now())
+    {
+    }
+
+    ~ScopedZone()
+    {
+        uint64_t index = m_thread.count.load(std::memory_order_relaxed);
+        m_thread.events[index % EVENTS_PER_THREAD] = { m_name, m_begin, Now(), m_depth };
+        m_thread.count.store(index + 1, std::memory_order_release);
+        --m_thread.depth;
+    }
+
+    ScopedZone(const ScopedZone&) = delete;
+    ScopedZone& operator=(const ScopedZone&) = delete;
+
+private:
+    ThreadEvents& m_thread;
+    const char* m_name;
+    uint32_t m_depth;
+    uint64_t m_begin;
+};
+
+}
+
+#if VCT_PROFILER
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) ::Profiler::ScopedZone PROFILE_CONCAT(profileZone, __LINE__){ name }
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_THREAD(name) ::Profiler::SetThreadName(name)
+#define PROFILE_FRAME() ::Profiler::BeginFrame()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
@@ -0,0 +1,126 @@
+#include "scene.h"
+#include "profiler.h"
+#include "utils.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <assimp/mesh.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+SceneView SceneData::View() const
+{
+    SceneView view;
+    view.aabb[0] = aabb[0];
+    view.aabb[1] = aabb[1];
+    view.meshes = meshes.data();
+    view.meshCount = static_cast<uint32_t>(meshes.size());
+    view.materials = materials.data();
+    view.materialCount = static_cast<uint32_t>(materials.size());
+    view.maps = maps.data();
+    view.mapCount = static_cast<uint32_t>(maps.size());
+    view.strings = strings.data();
+    view.stringsSize = static_cast<uint32_t>(strings.size());
+    view.vertices = vertices.data();
+    view.vertexCount = static_cast<uint32_t>(vertices.size());
+    view.indices = indices.data();
+    view.indexCount = static_cast<uint32_t>(indices.size());
+    view.meshlets = meshlets.data();
+    view.meshletCount = static_cast<uint32_t>(meshlets.size());
+    return view;
+}
+
+void ImportScene(const std::filesystem::path& path, SceneData& outScene)
+{
+    PROFILE_FUNCTION();
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path.string(),
+                                             aiProcess_CalcTangentSpace |
+                                             aiProcess_Triangulate |
+                                             aiProcess_JoinIdenticalVertices |
+                                             aiProcess_SortByPType |
+                                             aiProcess_GenBoundingBoxes);
+
+    if (!scene) {
+        std::cerr << importer.GetErrorString() << std::endl;
+        std::terminate();
+    }
+
+    std::cout << "--- Scene imported successfully ---\n";
+    std::cout << "Mesh count: " << scene->mNumMeshes << '\n';
+    std::cout << "Material count: " << scene->mNumMaterials << '\n';
+    std::cout << "Texture count: " << scene->mNumTextures << '\n';
+
+    outScene.materials.resize(scene->mNumMaterials);
+    for (uint32_t i = 0; i < scene->mNumMaterials; ++i) {
+        auto material = scene->mMaterials[i];
+        auto& record = outScene.materials[i];
+        record.firstMap = static_cast<uint32_t>(outScene.maps.size());
+        for (uint32_t j = 1; j < AI_TEXTURE_TYPE_MAX; ++j) {
+            if (material->GetTextureCount(static_cast<aiTextureType>(j))) {
+                aiString tmpPath;
+                material->GetTexture(static_cast<aiTextureType>(j), 0, &tmpPath);
+                std::string texPath = tmpPath.C_Str();
+                std::replace(texPath.begin(), texPath.end(), '\\', '/');
+
+                MapRecord map;
+                map.slot = j - 1;
+                map.pathOffset = static_cast<uint32_t>(outScene.strings.size());
+                map.pathLength = static_cast<uint32_t>(texPath.size());
+                outScene.strings += texPath;
+                outScene.maps.push_back(map);
+            }
+        }
+        record.mapCount = static_cast<uint32_t>(outScene.maps.size()) - record.firstMap;
+
+        int32_t twoSided = 0;
+        if (material->Get(AI_MATKEY_TWOSIDED, twoSided)) {
+            record.twoSided = 1;
+        }
+    }
+
+    glm::vec3 sceneMin{ std::numeric_limits<float>::max() };
+    glm::vec3 sceneMax{ std::numeric_limits<float>::lowest() };
+
+    outScene.meshes.resize(scene->mNumMeshes);
+    for (uint32_t i = 0; i < scene->mNumMeshes; ++i) {
+        auto mesh = scene->mMeshes[i];
+        auto& record = outScene.meshes[i];
+
+        record.firstVertex = static_cast<uint32_t>(outScene.vertices.size());
+        record.vertexCount = mesh->mNumVertices;
+        record.firstIndex = static_cast<uint32_t>(outScene.indices.size());
+        record.indexCount = mesh->mNumFaces * 3;
+        record.materialIndex = mesh->mMaterialIndex;
+        record.aabbMin = glm::vec4(Cast<glm::vec3>(mesh->mAABB.mMin), 1);
+        record.aabbMax = glm::vec4(Cast<glm::vec3>(mesh->mAABB.mMax), 1);
+
+        sceneMin = glm::min(sceneMin, glm::vec3(record.aabbMin));
+        sceneMax = glm::max(sceneMax, glm::vec3(record.aabbMax));
+
+        /* Load vertices */
+        for (uint32_t j = 0; j < mesh->mNumVertices; ++j) {
+            Vertex vertex;
+            vertex.position = Cast<glm::vec3>(mesh->mVertices[j]);
+            vertex.normal = Cast<glm::vec3>(mesh->mNormals[j]);
+            vertex.texCoord = glm::vec2(mesh->mTextureCoords[0][j].x,
+                                        1.f - mesh->mTextureCoords[0][j].y);
+            outScene.vertices.push_back(vertex);
+        }
+
+        /* Load indices */
+        for (uint32_t j = 0; j < mesh->mNumFaces; ++j) {
+            outScene.indices.push_back(mesh->mFaces[j].mIndices[0]);
+            outScene.indices.push_back(mesh->mFaces[j].mIndices[1]);
+            outScene.indices.push_back(mesh->mFaces[j].mIndices[2]);
+        }
+    }
+
+    outScene.aabb[0] = sceneMin;
+    outScene.aabb[1] = sceneMax;
+
+    importer.FreeScene();
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct Vertex 
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoord;
+};
+
+/* Records below are written to the baked scene as is, keep them POD and 16-byte aligned */
+
+struct MeshRecord
+{
+    uint32_t firstVertex{ 0 };
+    uint32_t vertexCount{ 0 };
+    uint32_t firstIndex{ 0 }; // indices are relative to firstVertex
+    uint32_t indexCount{ 0 };
+    uint32_t materialIndex{ 0 };
+    uint32_t firstMeshlet{ 0 };
+    uint32_t meshletCount{ 0 };
+    uint32_t padding{ 0 };
+    glm::vec4 aabbMin{ 0 };
+    glm::vec4 aabbMax{ 0 };
+};
+
+struct MaterialRecord
+{
+    uint32_t firstMap{ 0 };
+    uint32_t mapCount{ 0 };
+    uint32_t twoSided{ 0 };
+    uint32_t padding{ 0 };
+};
+
+// A texture reference of a material, path is relative to the model directory
+struct MapRecord
+{
+    uint32_t slot{ 0 }; // equals to (aiTextureType_x - 1)
+    uint32_t pathOffset{ 0 };
+    uint32_t pathLength{ 0 };
+    uint32_t padding{ 0 };
+};
+
+/* Cluster of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles.
+ * The triangles of a meshlet are a contiguous range of its mesh's indices, so it can be drawn
+ * with the regular index buffer. The layout matches std430 for GPU culling:
+ *
+ * struct Meshlet {
+ *     vec4 boundingSphere;
+ *     vec4 coneApex;
+ *     vec4 coneAxisCutoff;
+ *     vec4 aabbMin;
+ *     vec4 aabbMax;
+ *     uint firstIndex, indexCount, baseVertex, meshIndex;
+ * };
+ */
+struct Meshlet
+{
+    glm::vec4 boundingSphere{ 0 }; // xyz center, w radius
+    glm::vec4 coneApex{ 0 };
+    glm::vec4 coneAxisCutoff{ 0 }; // backfacing when dot(normalize(apex - eye), axis) >= cutoff, cutoff > 1 never culls
+    glm::vec4 aabbMin{ 0 };
+    glm::vec4 aabbMax{ 0 };
+    uint32_t firstIndex{ 0 }; // into the scene index buffer
+    uint32_t indexCount{ 0 };
+    uint32_t baseVertex{ 0 };
+    uint32_t meshIndex{ 0 };
+};
+static_assert(sizeof(Meshlet) == 96);
+
+// Non-owning view of a scene, points either into a mapped scene cache or into SceneData
+struct SceneView
+{
+    glm::vec3 aabb[2]{};
+
+    const MeshRecord* meshes{ nullptr };
+    uint32_t meshCount{ 0 };
+    const MaterialRecord* materials{ nullptr };
+    uint32_t materialCount{ 0 };
+    const MapRecord* maps{ nullptr };
+    uint32_t mapCount{ 0 };
+    const char* strings{ nullptr };
+    uint32_t stringsSize{ 0 };
+    const Vertex* vertices{ nullptr };
+    uint32_t vertexCount{ 0 };
+    const uint32_t* indices{ nullptr };
+    uint32_t indexCount{ 0 };
+    const Meshlet* meshlets{ nullptr };
+    uint32_t meshletCount{ 0 };
+
+    std::string MapPath(const MapRecord& map) const
+    {
+        return std::string{ strings + map.pathOffset, map.pathLength };
+    }
+};
+
+// Owning storage of an imported scene
+struct SceneData
+{
+    glm::vec3 aabb[2]{};
+    std::vector<MeshRecord> meshes;
+    std::vector<MaterialRecord> materials;
+    std::vector<MapRecord> maps;
+    std::string strings;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Meshlet> meshlets;
+
+    SceneView View() const;
+};
+
+// Run the Assimp import of a model file and flatten it into SceneData
+void ImportScene(const std::filesystem::path& path, SceneData& outScene);
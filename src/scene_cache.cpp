@@ -0,0 +1,179 @@
+#include "scene_cache.h"
+#include "profiler.h"
+#include "utils.h"
+
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+
+enum SceneCacheSection
+{
+    SECTION_MESHES,
+    SECTION_MATERIALS,
+    SECTION_MAPS,
+    SECTION_STRINGS,
+    SECTION_VERTICES,
+    SECTION_INDICES,
+    SECTION_MESHLETS,
+    SECTION_COUNT
+};
+
+struct SceneCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    glm::vec4 aabbMin;
+    glm::vec4 aabbMax;
+    uint64_t offsets[SECTION_COUNT];
+    uint64_t sizes[SECTION_COUNT];
+};
+
+constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+template <typename T>
+bool GetSection(const MappedFile& file, const SceneCacheHeader& header, SceneCacheSection section,
+                const T*& outData, uint32_t& outCount)
+{
+    uint64_t offset = header.offsets[section];
+    uint64_t size = header.sizes[section];
+    if (offset % SECTION_ALIGNMENT != 0 || offset > file.Size() || size > file.Size() - offset || size % sizeof(T) != 0) {
+        return false;
+    }
+    outData = reinterpret_cast<const T*>(file.Data() + offset);
+    outCount = static_cast<uint32_t>(size / sizeof(T));
+    return true;
+}
+
+}
+
+uint64_t HashSourceFiles(const std::vector<std::filesystem::path>& paths)
+{
+    PROFILE_FUNCTION();
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+    for (const auto& path : paths) {
+        MappedFile file;
+        if (!file.Open(path)) {
+            std::cerr << "Could not hash file \"" << path.string() << "\"\n";
+            continue;
+        }
+        hash = HashBytes(file.Data(), file.Size(), hash);
+    }
+    return hash;
+}
+
+bool LoadSceneCache(const std::filesystem::path& path, uint64_t sourceHash, 
+                    MappedFile& outFile, SceneView& outView)
+{
+    PROFILE_FUNCTION();
+    if (!outFile.Open(path)) {
+        return false;
+    }
+
+    if (outFile.Size() < sizeof(SceneCacheHeader)) {
+        outFile.Close();
+        return false;
+    }
+
+    auto& header = *reinterpret_cast<const SceneCacheHeader*>(outFile.Data());
+    if (header.magic != SCENE_CACHE_MAGIC || header.version != SCENE_CACHE_VERSION) {
+        std::cout << "Scene cache \"" << path.string() << "\" has an incompatible version\n";
+        outFile.Close();
+        return false;
+    }
+    if (header.sourceHash != sourceHash) {
+        std::cout << "Scene cache \"" << path.string() << "\" is stale\n";
+        outFile.Close();
+        return false;
+    }
+
+    SceneView view;
+    view.aabb[0] = header.aabbMin;
+    view.aabb[1] = header.aabbMax;
+    bool ok = GetSection(outFile, header, SECTION_MESHES, view.meshes, view.meshCount) &&
+              GetSection(outFile, header, SECTION_MATERIALS, view.materials, view.materialCount) &&
+              GetSection(outFile, header, SECTION_MAPS, view.maps, view.mapCount) &&
+              GetSection(outFile, header, SECTION_STRINGS, view.strings, view.stringsSize) &&
+              GetSection(outFile, header, SECTION_VERTICES, view.vertices, view.vertexCount) &&
+              GetSection(outFile, header, SECTION_INDICES, view.indices, view.indexCount) &&
+              GetSection(outFile, header, SECTION_MESHLETS, view.meshlets, view.meshletCount);
+    if (!ok) {
+        std::cerr << "Scene cache \"" << path.string() << "\" is corrupt\n";
+        outFile.Close();
+        return false;
+    }
+
+    outView = view;
+    return true;
+}
+
+void SaveSceneCache(const std::filesystem::path& path, uint64_t sourceHash, const SceneView& scene)
+{
+    PROFILE_FUNCTION();
+    const void* data[SECTION_COUNT] = {
+        scene.meshes, scene.materials, scene.maps, 
+        scene.strings, scene.vertices, scene.indices,
+        scene.meshlets
+    };
+
+    SceneCacheHeader header{};
+    header.magic = SCENE_CACHE_MAGIC;
+    header.version = SCENE_CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.aabbMin = glm::vec4(scene.aabb[0], 1);
+    header.aabbMax = glm::vec4(scene.aabb[1], 1);
+    header.sizes[SECTION_MESHES] = uint64_t{ scene.meshCount } * sizeof(MeshRecord);
+    header.sizes[SECTION_MATERIALS] = uint64_t{ scene.materialCount } * sizeof(MaterialRecord);
+    header.sizes[SECTION_MAPS] = uint64_t{ scene.mapCount } * sizeof(MapRecord);
+    header.sizes[SECTION_STRINGS] = scene.stringsSize;
+    header.sizes[SECTION_VERTICES] = uint64_t{ scene.vertexCount } * sizeof(Vertex);
+    header.sizes[SECTION_INDICES] = uint64_t{ scene.indexCount } * sizeof(uint32_t);
+    header.sizes[SECTION_MESHLETS] = uint64_t{ scene.meshletCount } * sizeof(Meshlet);
+
+    uint64_t offset = AlignUp(sizeof(SceneCacheHeader), SECTION_ALIGNMENT);
+    for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+        header.offsets[i] = offset;
+        offset = AlignUp(offset + header.sizes[i], SECTION_ALIGNMENT);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Write to a temporary file first so that an interrupted bake never leaves a valid-looking cache
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream ofs{ tmpPath, std::ios::binary | std::ios::trunc };
+        if (!ofs.is_open()) {
+            std::cerr << "Could not write scene cache \"" << path.string() << "\"\n";
+            return;
+        }
+
+        const char zeros[SECTION_ALIGNMENT]{};
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t written = sizeof(header);
+        for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+            ofs.write(zeros, header.offsets[i] - written);
+            ofs.write(static_cast<const char*>(data[i]), header.sizes[i]);
+            written = header.offsets[i] + header.sizes[i];
+        }
+        ofs.write(zeros, offset - written);
+
+        if (!ofs.good()) {
+            std::cerr << "Could not write scene cache \"" << path.string() << "\"\n";
+            return;
+        }
+    }
+
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::cerr << "Could not write scene cache \"" << path.string() << "\": " << ec.message() << '\n';
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "scene.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+/* Baked scene (.vctscene)
+ * A header followed by 16-byte aligned blobs laid out exactly as the GPU and SceneView
+ * consume them, so a warm start only maps the file and hands out pointers into it.
+ */
+
+constexpr uint32_t SCENE_CACHE_MAGIC = 0x53544356; // "VCTS"
+// Bump whenever the layout or the bake pipeline changes
+constexpr uint32_t SCENE_CACHE_VERSION = 3;
+
+// Hash the contents of the source files, used to invalidate stale caches
+uint64_t HashSourceFiles(const std::vector<std::filesystem::path>& paths);
+
+// Map the cache and point outView into it, fails if it is missing, corrupt or stale
+bool LoadSceneCache(const std::filesystem::path& path, uint64_t sourceHash, 
+                    MappedFile& outFile, SceneView& outView);
+
+void SaveSceneCache(const std::filesystem::path& path, uint64_t sourceHash, const SceneView& scene);
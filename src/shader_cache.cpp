@@ -0,0 +1,124 @@
+#include "shader_cache.h"
+#include "mapped_file.h"
+#include "profiler.h"
+#include "utils.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+struct ProgramCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+};
+
+}
+
+uint64_t HashDriverIdentity()
+{
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        auto str = reinterpret_cast<const char*>(glGetString(name));
+        if (str) {
+            hash = HashBytes(str, std::strlen(str), hash);
+        }
+    }
+    return hash;
+}
+
+bool SupportsProgramBinaries()
+{
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+bool LoadProgramBinary(const std::filesystem::path& path, uint64_t key, GLuint program)
+{
+    PROFILE_FUNCTION();
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+
+    if (file.Size() < sizeof(ProgramCacheHeader)) {
+        return false;
+    }
+    auto& header = *reinterpret_cast<const ProgramCacheHeader*>(file.Data());
+    if (header.magic != PROGRAM_CACHE_MAGIC || header.version != PROGRAM_CACHE_VERSION) {
+        std::cout << "Program cache \"" << path.string() << "\" has an incompatible version\n";
+        return false;
+    }
+    if (header.key != key) {
+        std::cout << "Program cache \"" << path.string() << "\" is stale\n";
+        return false;
+    }
+    if (header.binarySize > file.Size() - sizeof(ProgramCacheHeader)) {
+        std::cerr << "Program cache \"" << path.string() << "\" is corrupt\n";
+        return false;
+    }
+
+    glProgramBinary(program, header.binaryFormat, file.Data() + sizeof(ProgramCacheHeader), header.binarySize);
+
+    // Drivers may reject a binary after an update even when the version string is unchanged
+    GLint ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        std::cout << "Program cache \"" << path.string() << "\" was rejected by the driver\n";
+        return false;
+    }
+    return true;
+}
+
+void SaveProgramBinary(const std::filesystem::path& path, uint64_t key, GLuint program)
+{
+    PROFILE_FUNCTION();
+    GLint binarySize = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+    if (binarySize <= 0) {
+        return;
+    }
+
+    ProgramCacheHeader header{};
+    header.magic = PROGRAM_CACHE_MAGIC;
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    std::vector<char> binary(binarySize);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, binarySize, nullptr, &binaryFormat, binary.data());
+    header.binaryFormat = binaryFormat;
+    header.binarySize = static_cast<uint32_t>(binarySize);
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Same temporary-then-rename scheme as the scene cache
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream ofs{ tmpPath, std::ios::binary | std::ios::trunc };
+        if (!ofs.is_open()) {
+            std::cerr << "Could not write program cache \"" << path.string() << "\"\n";
+            return;
+        }
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(binary.data(), binary.size());
+        if (!ofs.good()) {
+            std::cerr << "Could not write program cache \"" << path.string() << "\"\n";
+            return;
+        }
+    }
+
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::cerr << "Could not write program cache \"" << path.string() << "\": " << ec.message() << '\n';
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <filesystem>
+
+/* Program binary cache (.vctprog)
+ * glGetProgramBinary output behind a small header. The key covers the stage sources and the
+ * driver identity, since a binary is only valid for the driver that produced it.
+ */
+
+constexpr uint32_t PROGRAM_CACHE_MAGIC = 0x50544356; // "VCTP"
+constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// Hash of GL_VENDOR, GL_RENDERER and GL_VERSION, needs a current GL context
+uint64_t HashDriverIdentity();
+
+// False when the driver exposes no binary formats, the cache is skipped entirely then
+bool SupportsProgramBinaries();
+
+// Load the cached binary into program, fails if it is missing, stale or rejected by the driver
+bool LoadProgramBinary(const std::filesystem::path& path, uint64_t key, GLuint program);
+
+// program must be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+void SaveProgramBinary(const std::filesystem::path& path, uint64_t key, GLuint program);
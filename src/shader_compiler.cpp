@@ -0,0 +1,388 @@
+#include "shader_compiler.h"
+#include "profiler.h"
+#include "shader_cache.h"
+#include "utils.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// GL_KHR_parallel_shader_compile, not part of the generated core loader
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (GLAD_API_PTR *PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+namespace
+{
+
+float MsSince(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start).count() / 1000.f;
+}
+
+std::string ShaderInfoLog(GLuint shader)
+{
+    GLint length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    std::string log(std::max(length, 1), '\0');
+    glGetShaderInfoLog(shader, length, nullptr, log.data());
+    log.resize(std::strlen(log.c_str()));
+    return log;
+}
+
+std::string ProgramInfoLog(GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    std::string log(std::max(length, 1), '\0');
+    glGetProgramInfoLog(program, length, nullptr, log.data());
+    log.resize(std::strlen(log.c_str()));
+    return log;
+}
+
+}
+
+void ShaderCompiler::Init(GLADloadfunc load, const std::filesystem::path& cacheDir, ShaderDefines globalDefines)
+{
+    m_start = Clock::now();
+    m_cacheDir = cacheDir;
+    m_globalDefines = std::move(globalDefines);
+    m_useBinaries = SupportsProgramBinaries();
+    m_driverHash = HashDriverIdentity();
+
+    if (HasGLExtension("GL_KHR_parallel_shader_compile")) {
+        auto maxShaderCompilerThreads =
+            reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(load("glMaxShaderCompilerThreadsKHR"));
+        if (maxShaderCompilerThreads) {
+            maxShaderCompilerThreads(0xffffffff); // as many as the driver wants
+            m_parallel = true;
+        }
+    }
+    std::cout << "Parallel shader compile: " << (m_parallel ? "yes" : "no") << '\n';
+}
+
+void ShaderCompiler::Submit(GLuint& program, const char* name, std::initializer_list<ShaderStage> stages, bool critical,
+                            const ShaderDefines& permutation)
+{
+    PROFILE_FUNCTION();
+    Program record{ name, &program, critical, stages, permutation };
+    record.cachePath = m_cacheDir / name;
+    if (!permutation.empty()) {
+        // e.g. voxelize[COLLECT_STATS=1] in the logs and voxelize-1a2b3c4d.vctprog on disk
+        std::stringstream suffix;
+        suffix << '-' << std::hex << std::setw(8) << std::setfill('0') << static_cast<uint32_t>(HashDefines(permutation));
+        record.cachePath += suffix.str();
+        record.name += '[';
+        for (const auto& define : permutation) {
+            record.name += (&define == permutation.data() ? "" : ",") + define.name + '=' + define.value;
+        }
+        record.name += ']';
+    }
+    record.cachePath += ".vctprog";
+    m_programs.push_back(std::move(record));
+
+    Job job{ static_cast<uint32_t>(m_programs.size() - 1), glCreateProgram(), false };
+    program = job.program;
+    if (!Preprocess(m_programs.back(), job)) {
+        std::cerr << m_programs.back().error << '\n';
+        std::terminate();
+    }
+    if (!Start(job)) {
+        m_jobs.push_back(std::move(job));
+    }
+}
+
+void ShaderCompiler::WaitCritical()
+{
+    PROFILE_FUNCTION();
+    for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+        if (!it->reload && m_programs[it->programIndex].critical) {
+            Finish(*it);
+            it = m_jobs.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    std::cout << "Critical shaders ready after " << MsSince(m_start) << " ms\n";
+    if (m_jobs.empty()) {
+        LogDone();
+    }
+    else {
+        Poll();
+    }
+}
+
+void ShaderCompiler::Poll()
+{
+    if (m_jobs.empty()) {
+        return;
+    }
+
+    PROFILE_FUNCTION();
+    for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+        if (IsComplete(*it)) {
+            Finish(*it);
+            it = m_jobs.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    if (m_jobs.empty()) {
+        LogDone();
+    }
+}
+
+void ShaderCompiler::Reload(const std::vector<std::filesystem::path>& changedFiles)
+{
+    PROFILE_FUNCTION();
+    for (uint32_t i = 0; i < m_programs.size(); ++i) {
+        auto& record = m_programs[i];
+        bool affected = std::any_of(changedFiles.begin(), changedFiles.end(), [&](const std::filesystem::path& file) {
+            return std::find(record.files.begin(), record.files.end(), file) != record.files.end();
+        });
+        if (!affected) {
+            continue;
+        }
+
+        // A program that has never been ready is replaced outright, its failures stay fatal
+        auto pending = std::find_if(m_jobs.begin(), m_jobs.end(), [i](const Job& job) { return job.programIndex == i; });
+        bool initial = pending != m_jobs.end() && !pending->reload;
+        CancelJob(i);
+
+        std::cout << "Reloading program \"" << record.name << "\"\n";
+        Job job{ i, glCreateProgram(), !initial };
+        if (initial) {
+            *record.target = job.program;
+        }
+        if (!Preprocess(record, job)) {
+            Fail(job, record.error);
+            continue;
+        }
+        if (!Start(job)) {
+            m_jobs.push_back(std::move(job));
+        }
+        else if (job.reload) {
+            Complete(job);
+        }
+    }
+}
+
+bool ShaderCompiler::IsReady(GLuint program) const
+{
+    return std::none_of(m_jobs.begin(), m_jobs.end(), [program](const Job& job) { return job.program == program; });
+}
+
+const ProgramReflection& ShaderCompiler::Reflection(GLuint program) const
+{
+    static const ProgramReflection empty;
+    auto it = m_reflections.find(program);
+    return it != m_reflections.end() ? it->second : empty;
+}
+
+bool ShaderCompiler::HasErrors() const
+{
+    return std::any_of(m_programs.begin(), m_programs.end(), [](const Program& record) { return !record.error.empty(); });
+}
+
+void ShaderCompiler::DrawErrors() const
+{
+    for (const auto& record : m_programs) {
+        if (!record.error.empty()) {
+            ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), "%s", record.name.c_str());
+            ImGui::TextWrapped("%s", record.error.c_str());
+        }
+    }
+}
+
+bool ShaderCompiler::Preprocess(Program& record, Job& job)
+{
+    ShaderDefines defines = m_globalDefines;
+    defines.insert(defines.end(), record.permutation.begin(), record.permutation.end());
+
+    job.key = m_driverHash;
+    job.sources.clear();
+    std::vector<std::filesystem::path> files;
+    bool ok = true;
+    for (const auto& stage : record.stages) {
+        PreprocessedShader shader;
+        std::string error;
+        ok = PreprocessShader(stage.path, defines, shader, error);
+        for (const auto& file : shader.files) {
+            if (std::find(files.begin(), files.end(), file) == files.end()) {
+                files.push_back(file);
+            }
+        }
+        if (!ok) {
+            record.error = error;
+            break;
+        }
+        job.key = HashBytes(&stage.type, sizeof(stage.type), job.key);
+        job.key = HashBytes(shader.source.data(), shader.source.size(), job.key);
+        job.sources.push_back(std::move(shader));
+    }
+
+    // Keep watching what was read before a failure, fixing an include has to trigger the next reload
+    if (ok) {
+        record.files = std::move(files);
+    }
+    else {
+        for (auto& file : files) {
+            if (std::find(record.files.begin(), record.files.end(), file) == record.files.end()) {
+                record.files.push_back(std::move(file));
+            }
+        }
+    }
+    return ok;
+}
+
+bool ShaderCompiler::Start(Job& job)
+{
+    const auto& record = m_programs[job.programIndex];
+    if (m_useBinaries && LoadProgramBinary(record.cachePath, job.key, job.program)) {
+        std::cout << "Program \"" << record.name << "\": cache hit\n";
+        ++m_hits;
+        if (!job.reload) {
+            m_reflections[job.program].Reflect(job.program);
+        }
+        return true;
+    }
+
+    // A rejected binary leaves the program unlinked, it is linked from source like a fresh one
+    std::cout << "Program \"" << record.name << "\": cache miss, compiling\n";
+    ++m_misses;
+    StartCompile(job);
+    return false;
+}
+
+void ShaderCompiler::StartCompile(Job& job)
+{
+    const auto& record = m_programs[job.programIndex];
+    for (size_t i = 0; i < record.stages.size(); ++i) {
+        GLuint shader = glCreateShader(record.stages[i].type);
+        auto srcCstr = job.sources[i].source.c_str();
+        glShaderSource(shader, 1, &srcCstr, nullptr);
+        glCompileShader(shader);
+        glAttachShader(job.program, shader);
+        job.shaders.push_back(shader);
+    }
+    if (m_useBinaries) {
+        glProgramParameteri(job.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    // Linking waits for the stages inside the driver, nothing here has to
+    glLinkProgram(job.program);
+}
+
+bool ShaderCompiler::IsComplete(const Job& job) const
+{
+    if (!m_parallel) {
+        return true; // no way to ask, Finish blocks
+    }
+    GLint complete = 0;
+    glGetProgramiv(job.program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+void ShaderCompiler::Finish(Job& job)
+{
+    PROFILE_FUNCTION();
+    const auto& record = m_programs[job.programIndex];
+    int ok = 0;
+    glGetProgramiv(job.program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        std::stringstream error;
+        for (size_t i = 0; i < job.shaders.size(); ++i) {
+            glGetShaderiv(job.shaders[i], GL_COMPILE_STATUS, &ok);
+            if (!ok) {
+                error << "Failed to compile shader \"" << record.stages[i].path << "\": " << ShaderInfoLog(job.shaders[i]);
+                // Messages are prefixed with the source string number of the #line directives
+                const auto& files = job.sources[i].files;
+                for (size_t file = 0; file < files.size(); ++file) {
+                    error << "  " << file << ": " << files[file].string() << '\n';
+                }
+                break;
+            }
+        }
+        if (error.tellp() == 0) {
+            error << "Failed to link program \"" << record.name << "\": " << ProgramInfoLog(job.program);
+        }
+        Fail(job, error.str());
+        return;
+    }
+
+    for (GLuint shader : job.shaders) {
+        glDetachShader(job.program, shader);
+        glDeleteShader(shader);
+    }
+    job.shaders.clear();
+
+    if (m_useBinaries) {
+        SaveProgramBinary(record.cachePath, job.key, job.program);
+    }
+    if (job.reload) {
+        Complete(job);
+    }
+    else {
+        m_reflections[job.program].Reflect(job.program);
+    }
+}
+
+void ShaderCompiler::Fail(Job& job, const std::string& error)
+{
+    auto& record = m_programs[job.programIndex];
+    std::cerr << error << '\n';
+    if (!job.reload) {
+        std::terminate();
+    }
+
+    for (GLuint shader : job.shaders) {
+        glDeleteShader(shader);
+    }
+    glDeleteProgram(job.program);
+    job.shaders.clear();
+    record.error = error;
+    std::cerr << "Program \"" << record.name << "\" keeps its previous version\n";
+}
+
+// Swap the reloaded program in, everything in the frame after this Poll uses the new one
+void ShaderCompiler::Complete(Job& job)
+{
+    auto& record = m_programs[job.programIndex];
+    GLuint old = *record.target;
+    *record.target = job.program;
+    m_reflections[job.program].Reflect(job.program);
+    m_reflections.erase(old);
+    glDeleteProgram(old);
+    record.error.clear();
+    std::cout << "Program \"" << record.name << "\" reloaded\n";
+}
+
+void ShaderCompiler::CancelJob(uint32_t programIndex)
+{
+    auto it = std::find_if(m_jobs.begin(), m_jobs.end(), [programIndex](const Job& job) { return job.programIndex == programIndex; });
+    if (it == m_jobs.end()) {
+        return;
+    }
+    for (GLuint shader : it->shaders) {
+        glDeleteShader(shader);
+    }
+    glDeleteProgram(it->program);
+    m_jobs.erase(it);
+}
+
+void ShaderCompiler::LogDone()
+{
+    if (m_initialDone) {
+        return;
+    }
+    m_initialDone = true;
+    std::cout << "--- Shaders ready after " << MsSince(m_start) << " ms (" << m_hits << " cached, "
+              << m_misses << " compiled) ---\n";
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "shader_preprocessor.h"
+#include "shader_reflection.h"
+
+#include <glad/gl.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ShaderStage
+{
+    const char* path; // must have static storage duration, reloads read it again
+    GLenum type;
+};
+
+/* Shader program compile pipeline
+ * Sources go through PreprocessShader with the global defines followed by the permutation's own.
+ * Submit hands every stage and the link to the driver without asking for any status, so a driver
+ * with GL_KHR_parallel_shader_compile compiles them on its own threads. Status is only queried once
+ * GL_COMPLETION_STATUS_KHR says it will not block, or when a program is needed right away.
+ * Linked programs are stored in the binary cache, see shader_cache.h, and reflected once.
+ * Every program remembers the files it was built from, Reload rebuilds the programs using a changed
+ * file in a new program object and only replaces the old one once the new one has linked.
+ * Must be used from the thread owning the GL context.
+ */
+class ShaderCompiler
+{
+public:
+    // load resolves the extension entry points, e.g. glfwGetProcAddress, globalDefines go into every stage
+    void Init(GLADloadfunc load, const std::filesystem::path& cacheDir, ShaderDefines globalDefines);
+
+    // program receives the handle right away and the new one after every successful reload, so it has to
+    // outlive the compiler. It can only be used once IsReady, critical programs are ready after WaitCritical.
+    // Every set of permutation defines of the same name is a separate program with its own cache entry.
+    void Submit(GLuint& program, const char* name, std::initializer_list<ShaderStage> stages, bool critical,
+                const ShaderDefines& permutation = {});
+
+    // Blocks until every critical program is linked
+    void WaitCritical();
+
+    // Finishes the programs the driver is done with without blocking, call once per frame
+    void Poll();
+
+    // Rebuild every program that read one of the files, e.g. the output of FileWatcher::Poll
+    void Reload(const std::vector<std::filesystem::path>& changedFiles);
+
+    bool IsReady(GLuint program) const;
+
+    // Empty until the program is ready, so lookups on a pending program return -1
+    const ProgramReflection& Reflection(GLuint program) const;
+    uint32_t PendingCount() const { return static_cast<uint32_t>(m_jobs.size()); }
+    bool IsParallel() const { return m_parallel; }
+
+    // Errors of failed reloads, a program keeps running its last good version until it links again
+    bool HasErrors() const;
+    void DrawErrors() const;
+
+private:
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct Program
+    {
+        std::string name;
+        GLuint* target;
+        bool critical;
+        std::vector<ShaderStage> stages;
+        ShaderDefines permutation;
+        std::filesystem::path cachePath;
+        std::vector<std::filesystem::path> files; // every stage and include
+        std::string error;
+    };
+
+    struct Job
+    {
+        uint32_t programIndex;
+        GLuint program;
+        bool reload; // failures are reported instead of fatal, the result replaces *target
+        uint64_t key{ 0 };
+        std::vector<PreprocessedShader> sources;
+        std::vector<GLuint> shaders;
+    };
+
+    bool Preprocess(Program& program, Job& job);
+    bool Start(Job& job); // true if the binary cache already had the program
+    void StartCompile(Job& job);
+    bool IsComplete(const Job& job) const;
+    void Finish(Job& job);
+    void Fail(Job& job, const std::string& error);
+    void Complete(Job& job);
+    void CancelJob(uint32_t programIndex);
+    void LogDone();
+
+    bool m_parallel{ false };
+    bool m_useBinaries{ false };
+    uint64_t m_driverHash{ 0 };
+    std::filesystem::path m_cacheDir;
+    ShaderDefines m_globalDefines;
+    std::vector<Program> m_programs;
+    std::vector<Job> m_jobs;
+    std::unordered_map<GLuint, ProgramReflection> m_reflections;
+
+    bool m_initialDone{ false };
+    uint32_t m_hits{ 0 };
+    uint32_t m_misses{ 0 };
+    Clock::time_point m_start;
+};
@@ -0,0 +1,137 @@
+#include "shader_preprocessor.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+namespace
+{
+
+bool LoadText(const std::filesystem::path& path, std::string& outText)
+{
+    std::ifstream ifs{ path };
+    if (!ifs.is_open()) {
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    outText = ss.str();
+    return true;
+}
+
+// Returns the directive name if line is a preprocessor directive, e.g. "include" for `  #  include "a.glsl"`
+std::string_view Directive(std::string_view line, std::string_view& outRest)
+{
+    size_t pos = line.find_first_not_of(" \t");
+    if (pos == std::string_view::npos || line[pos] != '#') {
+        return {};
+    }
+    pos = line.find_first_not_of(" \t", pos + 1);
+    if (pos == std::string_view::npos) {
+        return {};
+    }
+    size_t end = std::min(line.find_first_of(" \t", pos), line.size());
+    outRest = line.substr(end);
+    return line.substr(pos, end - pos);
+}
+
+class Preprocessor
+{
+public:
+    Preprocessor(const ShaderDefines& defines, PreprocessedShader& result, std::string& error)
+        : m_defines(defines), m_result(result), m_error(error)
+    {
+    }
+
+    bool Run(const std::filesystem::path& path)
+    {
+        m_result = PreprocessedShader{};
+        return Append(path.lexically_normal(), true);
+    }
+
+private:
+    bool Append(const std::filesystem::path& path, bool isRoot)
+    {
+        auto& files = m_result.files;
+        if (std::find(files.begin(), files.end(), path) != files.end()) {
+            return true;
+        }
+        uint32_t fileIndex = static_cast<uint32_t>(files.size());
+        files.push_back(path);
+
+        std::string text;
+        if (!LoadText(path, text)) {
+            m_error = "Could not open file \"" + path.string() + '"';
+            return false;
+        }
+        auto& out = m_result.source;
+        if (!isRoot) {
+            out += "#line 1 " + std::to_string(fileIndex) + '\n';
+        }
+
+        std::string_view remaining = text;
+        uint32_t lineNumber = 0;
+        while (!remaining.empty()) {
+            size_t eol = remaining.find('\n');
+            std::string_view line = remaining.substr(0, eol);
+            remaining = eol == std::string_view::npos ? std::string_view{} : remaining.substr(eol + 1);
+            ++lineNumber;
+
+            std::string_view rest;
+            auto directive = Directive(line, rest);
+            if (directive == "version") {
+                if (isRoot) {
+                    out.append(line) += '\n';
+                    for (const auto& define : m_defines) {
+                        out += "#define " + define.name + ' ' + define.value + '\n';
+                    }
+                    out += "#line " + std::to_string(lineNumber + 1) + ' ' + std::to_string(fileIndex) + '\n';
+                }
+                continue; // only the root file may decide the version
+            }
+            if (directive == "include") {
+                size_t open = rest.find('"');
+                size_t close = open == std::string_view::npos ? open : rest.find('"', open + 1);
+                if (close == std::string_view::npos) {
+                    m_error = path.string() + '(' + std::to_string(lineNumber) + "): malformed #include";
+                    return false;
+                }
+                auto includePath = path.parent_path() / std::string{ rest.substr(open + 1, close - open - 1) };
+                if (!Append(includePath.lexically_normal(), false)) {
+                    return false;
+                }
+                out += "#line " + std::to_string(lineNumber + 1) + ' ' + std::to_string(fileIndex) + '\n';
+                continue;
+            }
+            out.append(line) += '\n';
+        }
+        return true;
+    }
+
+    const ShaderDefines& m_defines;
+    PreprocessedShader& m_result;
+    std::string& m_error;
+};
+
+}
+
+bool PreprocessShader(const std::filesystem::path& path, const ShaderDefines& defines,
+                      PreprocessedShader& outShader, std::string& outError)
+{
+    return Preprocessor{ defines, outShader, outError }.Run(path);
+}
+
+uint64_t HashDefines(const ShaderDefines& defines)
+{
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+    for (const auto& define : defines) {
+        hash = HashBytes(define.name.data(), define.name.size(), hash);
+        hash = HashBytes("=", 1, hash);
+        hash = HashBytes(define.value.data(), define.value.size(), hash);
+        hash = HashBytes(";", 1, hash);
+    }
+    return hash;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+    std::string name;
+    std::string value;
+};
+
+using ShaderDefines = std::vector<ShaderDefine>;
+
+// Integral constants shared with the C++ side, e.g. MakeDefine("VOXEL_RESOLUTION", VOXEL_RESOLUTION)
+template <typename T>
+ShaderDefine MakeDefine(const char* name, T value)
+{
+    return { name, std::to_string(value) };
+}
+
+struct PreprocessedShader
+{
+    std::string source;
+    std::vector<std::filesystem::path> files; // indexed by the source string number of the #line directives
+};
+
+/* GLSL preprocessing done before the driver sees the source
+ * #include "file" is resolved relative to the including file, every file is pasted at most once.
+ * defines are inserted right after #version, #line directives keep compiler messages pointing at
+ * the original file and line.
+ * Fails on a missing file or a malformed #include, outError says where. outShader.files lists every
+ * file read so far either way, so a watcher knows what to look at for a fix.
+ */
+bool PreprocessShader(const std::filesystem::path& path, const ShaderDefines& defines,
+                      PreprocessedShader& outShader, std::string& outError);
+
+// Identifies a permutation, the order of the defines matters
+uint64_t HashDefines(const ShaderDefines& defines);
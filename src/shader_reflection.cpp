@@ -0,0 +1,62 @@
+#include "shader_reflection.h"
+
+#include <algorithm>
+#include <cstring>
+
+void ProgramReflection::Reflect(GLuint program)
+{
+    m_uniforms.clear();
+    m_blocks.clear();
+
+    GLint maxNameLength = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+    GLint blockNameLength = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_MAX_NAME_LENGTH, &blockNameLength);
+    std::vector<char> name(std::max(maxNameLength, blockNameLength) + 1);
+
+    GLint uniformCount = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+    for (GLint i = 0; i < uniformCount; ++i) {
+        // Members of uniform blocks have no location and are skipped
+        const GLenum props[] = { GL_LOCATION };
+        GLint location = -1;
+        glGetProgramResourceiv(program, GL_UNIFORM, i, 1, props, 1, nullptr, &location);
+        if (location < 0) {
+            continue;
+        }
+        glGetProgramResourceName(program, GL_UNIFORM, i, static_cast<GLsizei>(name.size()), nullptr, name.data());
+        std::string uniformName = name.data();
+        size_t length = uniformName.size();
+        if (length > 3 && uniformName.compare(length - 3, 3, "[0]") == 0) {
+            m_uniforms.push_back({ uniformName.substr(0, length - 3), location });
+        }
+        m_uniforms.push_back({ std::move(uniformName), location });
+    }
+
+    GLint blockCount = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &blockCount);
+    for (GLint i = 0; i < blockCount; ++i) {
+        glGetProgramResourceName(program, GL_UNIFORM_BLOCK, i, static_cast<GLsizei>(name.size()), nullptr, name.data());
+        m_blocks.push_back({ name.data(), i });
+    }
+}
+
+GLint ProgramReflection::Location(const char* name) const
+{
+    return Find(m_uniforms, name, -1);
+}
+
+GLuint ProgramReflection::BlockIndex(const char* name) const
+{
+    return static_cast<GLuint>(Find(m_blocks, name, static_cast<GLint>(GL_INVALID_INDEX)));
+}
+
+GLint ProgramReflection::Find(const std::vector<Entry>& entries, const char* name, GLint missing)
+{
+    for (const auto& entry : entries) {
+        if (std::strcmp(entry.name.c_str(), name) == 0) {
+            return entry.value;
+        }
+    }
+    return missing;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <string>
+#include <vector>
+
+/* Active uniforms and uniform blocks of a linked program
+ * Taken once after linking so that draws look locations up here instead of asking the driver.
+ * Arrays are found under their plain name, "u_hasMap" as well as "u_hasMap[0]".
+ */
+class ProgramReflection
+{
+public:
+    void Reflect(GLuint program);
+
+    // -1 when the uniform is not active, which glProgramUniform* silently ignores
+    GLint Location(const char* name) const;
+    GLuint BlockIndex(const char* name) const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        GLint value;
+    };
+
+    static GLint Find(const std::vector<Entry>& entries, const char* name, GLint missing);
+
+    std::vector<Entry> m_uniforms;
+    std::vector<Entry> m_blocks;
+};
@@ -0,0 +1,260 @@
+#include "sparse_voxel_octree.h"
+#include "profiler.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+
+constexpr const char* SVO_FLAG_CS_PATH = "resources/shaders/svo_flag.comp";
+constexpr const char* SVO_ALLOCATE_CS_PATH = "resources/shaders/svo_allocate.comp";
+constexpr const char* SVO_WRITE_LEAVES_CS_PATH = "resources/shaders/svo_write_leaves.comp";
+
+// SvoFragment is 3 uints, a brick 2x2x2 packed colors
+constexpr size_t FRAGMENT_SIZE = 3 * sizeof(uint32_t);
+constexpr size_t NODE_SIZE = sizeof(uint32_t);
+constexpr size_t BRICK_SIZE = 8 * sizeof(uint32_t);
+
+// Starting sizes, enough for a small scene at 1024^3
+constexpr uint32_t INITIAL_FRAGMENTS = 1 << 22;
+constexpr uint32_t INITIAL_NODES = 1 << 20;
+constexpr uint32_t INITIAL_BRICKS = 1 << 18;
+
+// Minimum GL_MAX_COMPUTE_WORK_GROUP_COUNT, larger dispatches wrap into y
+constexpr uint32_t MAX_GROUPS_X = 65535;
+
+constexpr float MB = 1024.f * 1024.f;
+
+void CreatePool(GLuint& buffer, size_t size)
+{
+    if (buffer) {
+        glDeleteBuffers(1, &buffer);
+    }
+    uint32_t zero = 0;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, size, nullptr, 0);
+    glClearNamedBufferData(buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+}
+
+}
+
+uint64_t SvoStats::BytesUsed() const
+{
+    return uint64_t{ nodes } * NODE_SIZE + uint64_t{ bricks } * BRICK_SIZE;
+}
+
+uint64_t SvoStats::BytesAllocated() const
+{
+    return uint64_t{ fragmentCapacity } * FRAGMENT_SIZE + uint64_t{ nodeCapacity } * NODE_SIZE +
+           uint64_t{ brickCapacity } * BRICK_SIZE;
+}
+
+void SparseVoxelOctree::SubmitShaders(ShaderCompiler& compiler)
+{
+    compiler.Submit(m_flagProgram, "svo_flag", { { SVO_FLAG_CS_PATH, GL_COMPUTE_SHADER } }, false);
+    compiler.Submit(m_allocateProgram, "svo_allocate", { { SVO_ALLOCATE_CS_PATH, GL_COMPUTE_SHADER } }, false);
+    compiler.Submit(m_writeLeavesProgram, "svo_write_leaves", { { SVO_WRITE_LEAVES_CS_PATH, GL_COMPUTE_SHADER } }, false);
+}
+
+bool SparseVoxelOctree::IsReady(const ShaderCompiler& compiler) const
+{
+    return compiler.IsReady(m_flagProgram) && compiler.IsReady(m_allocateProgram) &&
+           compiler.IsReady(m_writeLeavesProgram);
+}
+
+void SparseVoxelOctree::Create(uint32_t levels)
+{
+    if (levels == 0 || levels > MAX_LEVELS) {
+        std::cerr << "SVO levels must be in [1, " << MAX_LEVELS << "], got " << levels << std::endl;
+        std::terminate();
+    }
+    m_levels = levels;
+    glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &m_maxBufferSize);
+
+    m_counters = Counters{};
+    m_counters.fragmentCapacity = INITIAL_FRAGMENTS;
+    m_counters.nodeCapacity = INITIAL_NODES;
+    m_counters.brickCapacity = INITIAL_BRICKS;
+    CreatePool(m_fragmentBuffer, m_counters.fragmentCapacity * FRAGMENT_SIZE);
+    CreatePool(m_nodeBuffer, m_counters.nodeCapacity * NODE_SIZE);
+    CreatePool(m_brickBuffer, m_counters.brickCapacity * BRICK_SIZE);
+    glCreateBuffers(1, &m_counterBuffer);
+    glNamedBufferStorage(m_counterBuffer, sizeof(Counters), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    m_nodesWritten = 0;
+    m_bricksWritten = 0;
+
+    m_stats = SvoStats{};
+    m_stats.fragmentCapacity = m_counters.fragmentCapacity;
+    m_stats.nodeCapacity = m_counters.nodeCapacity;
+    m_stats.brickCapacity = m_counters.brickCapacity;
+}
+
+void SparseVoxelOctree::Destroy()
+{
+    GLuint buffers[] = { m_fragmentBuffer, m_nodeBuffer, m_brickBuffer, m_counterBuffer };
+    glDeleteBuffers(4, buffers);
+    m_fragmentBuffer = 0;
+    m_nodeBuffer = 0;
+    m_brickBuffer = 0;
+    m_counterBuffer = 0;
+}
+
+void SparseVoxelOctree::BeginFragments()
+{
+    m_counters.fragmentCount = 0;
+    glNamedBufferSubData(m_counterBuffer, 0, sizeof(Counters), &m_counters);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SVO_FRAGMENT_BINDING, m_fragmentBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SVO_COUNTER_BINDING, m_counterBuffer);
+}
+
+bool SparseVoxelOctree::EndFragments()
+{
+    // The readback and the build passes both need the fragments of the draws
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    ReadCounters();
+    if (m_counters.fragmentCount <= m_counters.fragmentCapacity) {
+        return true;
+    }
+    // At the limit the tree is built from the fragments that fit
+    return !Grow(m_fragmentBuffer, m_counters.fragmentCapacity, m_counters.fragmentCount, FRAGMENT_SIZE, "fragment");
+}
+
+void SparseVoxelOctree::Build(const ShaderCompiler& compiler)
+{
+    PROFILE_FUNCTION();
+    while (!BuildTree(compiler)) {
+    }
+    ++m_stats.builds;
+    Bind();
+}
+
+bool SparseVoxelOctree::BuildTree(const ShaderCompiler& compiler)
+{
+    // Everything past what the last build wrote is still zero, grown pools are cleared when created
+    uint32_t zero = 0;
+    if (m_nodesWritten > 0) {
+        glClearNamedBufferSubData(m_nodeBuffer, GL_R32UI, 0, m_nodesWritten * NODE_SIZE, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    }
+    if (m_bricksWritten > 0) {
+        glClearNamedBufferSubData(m_brickBuffer, GL_R32UI, 0, m_bricksWritten * BRICK_SIZE, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    }
+
+    // Node 0 is the root. Brick 0 stays empty, a last level node pointing to it has no voxels.
+    m_counters.nodeCount = 1;
+    m_counters.brickCount = 1;
+    std::fill(std::begin(m_counters.levelStart), std::end(m_counters.levelStart), 0);
+    glNamedBufferSubData(m_counterBuffer, 0, sizeof(Counters), &m_counters);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SVO_NODE_BINDING, m_nodeBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SVO_BRICK_BINDING, m_brickBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SVO_FRAGMENT_BINDING, m_fragmentBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SVO_COUNTER_BINDING, m_counterBuffer);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_counterBuffer);
+
+    const uint32_t fragments = std::min(m_counters.fragmentCount, m_counters.fragmentCapacity);
+    const GLint flagDepthLocation = compiler.Reflection(m_flagProgram).Location("u_depth");
+    const GLint allocateDepthLocation = compiler.Reflection(m_allocateProgram).Location("u_depth");
+    for (uint32_t depth = 0; depth < m_levels; ++depth) {
+        // Flagging also sizes the indirect allocate dispatch over the nodes of this level
+        glUseProgram(m_flagProgram);
+        glProgramUniform1ui(m_flagProgram, flagDepthLocation, depth);
+        Dispatch(fragments);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+        glUseProgram(m_allocateProgram);
+        glProgramUniform1ui(m_allocateProgram, allocateDepthLocation, depth);
+        glDispatchComputeIndirect(offsetof(Counters, allocateGroups));
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    glUseProgram(m_writeLeavesProgram);
+    Dispatch(fragments);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+    // Allocations past the end of a pool were dropped, their subtrees are missing
+    ReadCounters();
+    m_nodesWritten = std::min(m_counters.nodeCount, m_counters.nodeCapacity);
+    m_bricksWritten = std::min(m_counters.brickCount, m_counters.brickCapacity);
+    bool grown = false;
+    if (m_counters.nodeCount > m_counters.nodeCapacity &&
+        Grow(m_nodeBuffer, m_counters.nodeCapacity, m_counters.nodeCount, NODE_SIZE, "node")) {
+        m_nodesWritten = 0;
+        grown = true;
+    }
+    if (m_counters.brickCount > m_counters.brickCapacity &&
+        Grow(m_brickBuffer, m_counters.brickCapacity, m_counters.brickCount, BRICK_SIZE, "brick")) {
+        m_bricksWritten = 0;
+        grown = true;
+    }
+    return !grown;
+}
+
+void SparseVoxelOctree::Bind() const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SVO_NODE_BINDING, m_nodeBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SVO_BRICK_BINDING, m_brickBuffer);
+}
+
+void SparseVoxelOctree::ReadCounters()
+{
+    // Capacities are owned by this side, only the counts are taken from the GPU
+    Counters counters;
+    glGetNamedBufferSubData(m_counterBuffer, 0, sizeof(Counters), &counters);
+    m_counters.fragmentCount = counters.fragmentCount;
+    m_counters.nodeCount = counters.nodeCount;
+    m_counters.brickCount = counters.brickCount;
+
+    m_stats.fragments = counters.fragmentCount;
+    m_stats.nodes = std::min(counters.nodeCount, m_counters.nodeCapacity);
+    m_stats.bricks = std::min(counters.brickCount, m_counters.brickCapacity);
+}
+
+void SparseVoxelOctree::Dispatch(uint32_t invocations) const
+{
+    uint32_t groups = (invocations + GROUP_SIZE - 1) / GROUP_SIZE;
+    if (groups == 0) {
+        return;
+    }
+    uint32_t groupsX = std::min(groups, MAX_GROUPS_X);
+    glDispatchCompute(groupsX, (groups + groupsX - 1) / groupsX, 1);
+}
+
+bool SparseVoxelOctree::Grow(GLuint& buffer, uint32_t& capacity, uint32_t required, size_t elementSize, const char* name)
+{
+    uint64_t maxCapacity = std::min<uint64_t>(m_maxBufferSize / elementSize, UINT32_MAX);
+    uint64_t newCapacity = capacity;
+    do {
+        newCapacity *= 2;
+    } while (newCapacity < required);
+    newCapacity = std::min(newCapacity, maxCapacity);
+    if (newCapacity <= capacity) {
+        std::cerr << "SVO " << name << " pool is at its limit of " << capacity << ", the octree is incomplete\n";
+        return false;
+    }
+
+    capacity = static_cast<uint32_t>(newCapacity);
+    CreatePool(buffer, capacity * elementSize);
+    std::cout << "SVO " << name << " pool grown to " << capacity << " (" << capacity * elementSize / MB << " MB)\n";
+    m_stats.fragmentCapacity = m_counters.fragmentCapacity;
+    m_stats.nodeCapacity = m_counters.nodeCapacity;
+    m_stats.brickCapacity = m_counters.brickCapacity;
+    return true;
+}
+
+void SparseVoxelOctree::Draw() const
+{
+    const uint32_t resolution = Resolution();
+    const double denseBytes = double(resolution) * resolution * resolution * sizeof(uint32_t);
+    ImGui::Text("Resolution: %u^3, %u levels, %u builds", resolution, m_levels, m_stats.builds);
+    ImGui::Text("Fragments: %u/%u", m_stats.fragments, m_stats.fragmentCapacity);
+    ImGui::Text("Nodes: %u/%u, bricks: %u/%u", m_stats.nodes, m_stats.nodeCapacity, m_stats.bricks, m_stats.brickCapacity);
+    ImGui::Text("Tree: %.1f MB, allocated: %.1f MB, dense R32UI: %.1f MB", m_stats.BytesUsed() / MB,
+                m_stats.BytesAllocated() / MB, denseBytes / MB);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "shader_compiler.h"
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// Storage buffer bindings of include/svo.glsl
+constexpr GLuint SVO_NODE_BINDING = 2;
+constexpr GLuint SVO_BRICK_BINDING = 3;
+constexpr GLuint SVO_FRAGMENT_BINDING = 4;
+constexpr GLuint SVO_COUNTER_BINDING = 5;
+
+// Size of the last build, capacities are what the pools currently hold
+struct SvoStats
+{
+    uint32_t fragments{ 0 };
+    uint32_t nodes{ 0 };
+    uint32_t bricks{ 0 };
+    uint32_t fragmentCapacity{ 0 };
+    uint32_t nodeCapacity{ 0 };
+    uint32_t brickCapacity{ 0 };
+    uint32_t builds{ 0 };
+    uint64_t BytesUsed() const;
+    uint64_t BytesAllocated() const;
+};
+
+/* Sparse voxel octree, the alternative to the dense voxel volume
+ * The voxelize pass appends one fragment per covered voxel to a fragment list. Build then creates the
+ * tree top-down with one flag pass over the fragments and one allocate pass over the nodes per level,
+ * the nodes of a level are allocated together in tiles of 8 children. Nodes of the last level point to
+ * a brick of 2x2x2 voxels in the brick pool instead, a final pass writes the fragments into their bricks.
+ * Memory follows the surface area of the scene rather than the resolution cubed, see include/svo.glsl
+ * for the layout and the traversal used by the draw and trace shaders.
+ * Pools grow on demand: the fragment count and the pool counters are read back at the end of each step
+ * and a step that overflowed is repeated with larger pools. That readback stalls, builds are only done
+ * when the scene changes and not while it streams in.
+ */
+class SparseVoxelOctree
+{
+public:
+    static constexpr uint32_t MAX_LEVELS = 11; // fragment positions are stored in 16 bits
+    static constexpr uint32_t GROUP_SIZE = 64;
+
+    // Compute programs of the build, not critical since the octree is optional
+    void SubmitShaders(ShaderCompiler& compiler);
+    bool IsReady(const ShaderCompiler& compiler) const;
+
+    // resolution is 2^levels
+    void Create(uint32_t levels);
+    void Destroy();
+    bool IsCreated() const { return m_counterBuffer != 0; }
+
+    uint32_t Levels() const { return m_levels; }
+    uint32_t Resolution() const { return 1u << m_levels; }
+
+    // Bracket the voxelization pass writing the fragment list. EndFragments returns false when the list
+    // overflowed, it has been grown and the scene has to be voxelized again.
+    void BeginFragments();
+    bool EndFragments();
+
+    // Builds the tree from the fragment list, leaves the pools bound for the readers
+    void Build(const ShaderCompiler& compiler);
+
+    // Node and brick pools at their bindings, for shaders traversing the tree
+    void Bind() const;
+
+    const SvoStats& Stats() const { return m_stats; }
+    void Draw() const;
+
+private:
+    // std430 layout of SvoCounters in include/svo.glsl
+    struct Counters
+    {
+        uint32_t fragmentCount{ 0 };
+        uint32_t nodeCount{ 0 };
+        uint32_t brickCount{ 0 };
+        uint32_t fragmentCapacity{ 0 };
+        uint32_t nodeCapacity{ 0 };
+        uint32_t brickCapacity{ 0 };
+        uint32_t allocateGroups[3]{ 0 }; // DispatchIndirectCommand of the allocate pass
+        uint32_t levelStart[MAX_LEVELS + 1]{ 0 }; // first node of every level
+    };
+
+    bool BuildTree(const ShaderCompiler& compiler); // false if a pool overflowed and was grown
+    void ReadCounters();
+    void Dispatch(uint32_t invocations) const;
+    // Replaces a pool with a cleared one holding at least required elements, false if it is at its limit
+    bool Grow(GLuint& buffer, uint32_t& capacity, uint32_t required, size_t elementSize, const char* name);
+
+    uint32_t m_levels{ 0 };
+    GLint64 m_maxBufferSize{ 0 };
+    GLuint m_flagProgram{ 0 };
+    GLuint m_allocateProgram{ 0 };
+    GLuint m_writeLeavesProgram{ 0 };
+
+    GLuint m_fragmentBuffer{ 0 };
+    GLuint m_nodeBuffer{ 0 };
+    GLuint m_brickBuffer{ 0 };
+    GLuint m_counterBuffer{ 0 };
+    Counters m_counters;
+
+    // Pool ranges written by the last build, only those need clearing for the next one
+    uint32_t m_nodesWritten{ 0 };
+    uint32_t m_bricksWritten{ 0 };
+
+    SvoStats m_stats;
+};
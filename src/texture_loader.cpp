@@ -0,0 +1,496 @@
+#include "texture_loader.h"
+#include "bc_encoder.h"
+#include "mip_generator.h"
+#include "profiler.h"
+#include "thread_pool.h"
+#include "upload_ring.h"
+#include "utils.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+// Not part of core GL, but supported by every desktop driver
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+constexpr bool COMPRESS_TEXTURES = true;
+// Masked color maps use BC7 instead of BC3
+constexpr bool USE_BC7 = true;
+constexpr const char* TEXTURE_CACHE_PATH = "cache/textures";
+
+struct TextureLevel
+{
+    uint32_t width{ 0 };
+    uint32_t height{ 0 };
+    std::vector<uint8_t> data;
+};
+
+// CPU side result of loading one image
+struct LoadedTexture
+{
+    bool valid{ false };
+    bool compressed{ false };
+    bool fromCache{ false };
+    BlockFormat format{ BlockFormat::BC1 };
+    uint32_t channels{ 0 };
+    std::vector<TextureLevel> levels;
+
+    // Statistics
+    size_t rawBytes{ 0 };
+    float encodeSeconds{ 0 };
+};
+
+namespace
+{
+
+constexpr uint32_t TEXTURE_CACHE_MAGIC = 0x54544356; // "VCTT"
+constexpr uint32_t TEXTURE_CACHE_VERSION = 2;
+
+struct TextureCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+};
+
+std::string CanonicalizePath(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    auto canonical = std::filesystem::weakly_canonical(path, ec);
+    auto str = (ec ? path.lexically_normal() : canonical).generic_string();
+#ifdef _WIN32
+    // The file system is case-insensitive, MTLs are not consistent about it
+    std::transform(str.begin(), str.end(), str.begin(), 
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+    return str;
+}
+
+BlockFormat SelectFormat(TextureUsage usage, int channels, bool hasS3TC)
+{
+    BlockFormat format;
+    switch (usage) {
+    case TextureUsage::Color:
+        format = (channels == 4) ? (USE_BC7 ? BlockFormat::BC7 : BlockFormat::BC3) : BlockFormat::BC1;
+        break;
+    case TextureUsage::Normal:
+        format = BlockFormat::BC5;
+        break;
+    case TextureUsage::Mask:
+        format = BlockFormat::BC4;
+        break;
+    default:
+        format = (channels == 1) ? BlockFormat::BC4 :
+                 (channels == 2) ? BlockFormat::BC5 :
+                 (channels == 3) ? BlockFormat::BC1 :
+                 BlockFormat::BC3;
+        break;
+    }
+
+    if (!hasS3TC && (format == BlockFormat::BC1 || format == BlockFormat::BC3)) {
+        format = BlockFormat::BC7;
+    }
+    return format;
+}
+
+MipOptions SelectMipOptions(TextureUsage usage, int channels)
+{
+    MipOptions options;
+    switch (usage) {
+    case TextureUsage::Color:
+        options.filter = MipFilter::SRGB;
+        options.coverageChannel = (channels == 4) ? 3 : -1;
+        break;
+    case TextureUsage::Normal:
+        options.filter = MipFilter::Normal;
+        break;
+    case TextureUsage::Mask:
+        options.coverageChannel = 0;
+        break;
+    default:
+        break;
+    }
+    return options;
+}
+
+GLenum ToGLFormat(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return GL_NONE;
+}
+
+// The key covers the source file identity and everything that affects the encoded result
+std::filesystem::path TextureCachePath(const std::string& canonicalPath, BlockFormat format)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(canonicalPath, ec);
+    auto time = std::filesystem::last_write_time(canonicalPath, ec).time_since_epoch().count();
+
+    uint64_t hash = HashBytes(canonicalPath.data(), canonicalPath.size());
+    hash = HashBytes(&size, sizeof(size), hash);
+    hash = HashBytes(&time, sizeof(time), hash);
+    hash = HashBytes(&format, sizeof(format), hash);
+    hash = HashBytes(&TEXTURE_CACHE_VERSION, sizeof(TEXTURE_CACHE_VERSION), hash);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.vcttex", static_cast<unsigned long long>(hash));
+    return std::filesystem::path{ TEXTURE_CACHE_PATH } / name;
+}
+
+bool ReadTextureCache(const std::filesystem::path& path, BlockFormat format, LoadedTexture& outTexture)
+{
+    PROFILE_FUNCTION();
+    std::ifstream ifs{ path, std::ios::binary };
+    if (!ifs.is_open()) {
+        return false;
+    }
+
+    TextureCacheHeader header{};
+    ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!ifs || header.magic != TEXTURE_CACHE_MAGIC || header.version != TEXTURE_CACHE_VERSION ||
+        header.format != static_cast<uint32_t>(format) || header.levelCount == 0) {
+        return false;
+    }
+
+    outTexture.levels.resize(header.levelCount);
+    for (auto& level : outTexture.levels) {
+        uint32_t dims[2];
+        ifs.read(reinterpret_cast<char*>(dims), sizeof(dims));
+        level.width = dims[0];
+        level.height = dims[1];
+        level.data.resize(CompressedImageSize(format, level.width, level.height));
+        ifs.read(reinterpret_cast<char*>(level.data.data()), level.data.size());
+    }
+    if (!ifs) {
+        return false;
+    }
+
+    outTexture.compressed = true;
+    outTexture.format = format;
+    return true;
+}
+
+void WriteTextureCache(const std::filesystem::path& path, const LoadedTexture& texture)
+{
+    PROFILE_FUNCTION();
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream ofs{ tmpPath, std::ios::binary | std::ios::trunc };
+        if (!ofs.is_open()) {
+            return;
+        }
+
+        TextureCacheHeader header{};
+        header.magic = TEXTURE_CACHE_MAGIC;
+        header.version = TEXTURE_CACHE_VERSION;
+        header.format = static_cast<uint32_t>(texture.format);
+        header.width = texture.levels[0].width;
+        header.height = texture.levels[0].height;
+        header.levelCount = static_cast<uint32_t>(texture.levels.size());
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& level : texture.levels) {
+            uint32_t dims[2] = { level.width, level.height };
+            ofs.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+            ofs.write(reinterpret_cast<const char*>(level.data.data()), level.data.size());
+        }
+        if (!ofs.good()) {
+            return;
+        }
+    }
+    std::filesystem::rename(tmpPath, path, ec);
+}
+
+stbi_uc* DecodeImage(const std::string& path, int& width, int& height, int& channels, int desiredChannels)
+{
+    PROFILE_SCOPE("stbi_load");
+    return stbi_load(path.c_str(), &width, &height, &channels, desiredChannels);
+}
+
+void LoadTexture(const std::string& path, TextureUsage usage, bool hasS3TC, LoadedTexture& outTexture)
+{
+    PROFILE_FUNCTION();
+    if (!COMPRESS_TEXTURES) {
+        int width = 0, height = 0, channels = 0;
+        stbi_uc* pixels = DecodeImage(path, width, height, channels, 0);
+        if (!pixels) {
+            std::cerr << "Could not load texture \"" << path << "\": " << stbi_failure_reason() << '\n';
+            return;
+        }
+        outTexture.channels = channels;
+        outTexture.levels.resize(1);
+        outTexture.levels[0].width = width;
+        outTexture.levels[0].height = height;
+        outTexture.levels[0].data.assign(pixels, pixels + size_t{ 1 } * width * height * channels);
+        outTexture.rawBytes = outTexture.levels[0].data.size();
+        outTexture.valid = true;
+        stbi_image_free(pixels);
+        return;
+    }
+
+    // The header is enough to pick the format and find the cache entry
+    int width = 0, height = 0, channels = 0;
+    if (!stbi_info(path.c_str(), &width, &height, &channels)) {
+        std::cerr << "Could not load texture \"" << path << "\": " << stbi_failure_reason() << '\n';
+        return;
+    }
+    outTexture.rawBytes = size_t{ 1 } * width * height * channels;
+
+    BlockFormat format = SelectFormat(usage, channels, hasS3TC);
+    auto cachePath = TextureCachePath(path, format);
+    if (ReadTextureCache(cachePath, format, outTexture)) {
+        outTexture.fromCache = true;
+        outTexture.valid = true;
+        return;
+    }
+
+    stbi_uc* pixels = DecodeImage(path, width, height, channels, 4);
+    if (!pixels) {
+        std::cerr << "Could not load texture \"" << path << "\": " << stbi_failure_reason() << '\n';
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto mips = GenerateMipChain(pixels, width, height, SelectMipOptions(usage, channels));
+    stbi_image_free(pixels);
+
+    outTexture.compressed = true;
+    outTexture.format = format;
+    outTexture.levels.resize(mips.size());
+    for (size_t i = 0; i < mips.size(); ++i) {
+        auto& level = outTexture.levels[i];
+        level.width = mips[i].width;
+        level.height = mips[i].height;
+        level.data.resize(CompressedImageSize(format, level.width, level.height));
+        CompressImage(format, mips[i].rgba.data(), level.width, level.height, level.data.data());
+    }
+    outTexture.encodeSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+
+    WriteTextureCache(cachePath, outTexture);
+    outTexture.valid = true;
+}
+
+GLuint UploadCompressedTexture(const LoadedTexture& texture, UploadRing& ring)
+{
+    PROFILE_FUNCTION();
+    GLenum glFormat = ToGLFormat(texture.format);
+    const auto& base = texture.levels[0];
+
+    GLuint tex = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+    glTextureStorage2D(tex, static_cast<GLsizei>(texture.levels.size()), glFormat, base.width, base.height);
+    for (uint32_t i = 0; i < texture.levels.size(); ++i) {
+        const auto& level = texture.levels[i];
+        ring.UploadCompressedTexture(tex, i, level.width, level.height, glFormat, level.data.data(), level.data.size());
+    }
+
+    glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return tex;
+}
+
+}
+
+GLuint UploadTexture(UploadRing& ring, const void* img, uint32_t width, uint32_t height, uint32_t channels)
+{
+    PROFILE_FUNCTION();
+    constexpr GLenum INTERNAL_FORMATS[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+    constexpr GLenum FORMATS[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    if (channels < 1 || channels > 4) {
+        std::cerr << "Unsupported texture channel count\n";
+        std::terminate();
+    }
+
+    GLuint tex = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+    GLsizei levels = static_cast<GLsizei>(MipLevelCount(width, height));
+    glTextureStorage2D(tex, levels, INTERNAL_FORMATS[channels - 1], width, height);
+    ring.UploadTexture(tex, 0, width, height, FORMATS[channels - 1], GL_UNSIGNED_BYTE, img, 
+                       size_t{ width } * height * channels);
+
+    // Only the uncompressed fallback lets the driver build the chain, the compressed path uses precomputed mips
+    glGenerateTextureMipmap(tex);
+    glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return tex;
+}
+
+GLuint CreatePlaceholderTexture(UploadRing& ring, TextureUsage usage)
+{
+    // Indexed by TextureUsage: mid grey, flat +z normal, opaque mask, black
+    constexpr uint8_t TEXELS[][4] = {
+        { 200, 200, 200, 255 },
+        { 128, 128, 255, 255 },
+        { 255, 255, 255, 255 },
+        { 0, 0, 0, 255 },
+    };
+    return UploadTexture(ring, TEXELS[static_cast<int>(usage)], 1, 1, 4);
+}
+
+TextureStreamer::TextureStreamer() = default;
+
+TextureStreamer::~TextureStreamer()
+{
+    Cancel();
+}
+
+void TextureStreamer::Start(const std::vector<TextureRequest>& requests, bool hasS3TC)
+{
+    // Keeps a concurrent Cancel() from seeing a partially built task list
+    std::lock_guard startLock{ m_mutex };
+    m_start = Clock::now();
+    m_decodeEnd = m_start;
+    m_requestCount = static_cast<uint32_t>(requests.size());
+
+    /* Deduplicate */
+    std::unordered_map<std::string, uint32_t> pathToUnique;
+    for (uint32_t i = 0; i < requests.size(); ++i) {
+        auto path = CanonicalizePath(requests[i].path);
+        auto [it, inserted] = pathToUnique.try_emplace(path, static_cast<uint32_t>(m_paths.size()));
+        if (inserted) {
+            m_paths.push_back(path);
+            m_usages.push_back(requests[i].usage);
+            m_requestsOfUnique.emplace_back();
+        }
+        m_requestsOfUnique[it->second].push_back(i);
+    }
+
+    /* Decode and compress */
+    m_loaded.resize(m_paths.size());
+    for (auto& texture : m_loaded) {
+        texture = std::make_unique<LoadedTexture>();
+    }
+    auto& pool = GetThreadPool();
+    for (uint32_t i = 0; i < m_paths.size(); ++i) {
+        pool.Submit([this, i, hasS3TC] {
+            if (!m_cancel) {
+                LoadTexture(m_paths[i], m_usages[i], hasS3TC, *m_loaded[i]);
+            }
+            std::lock_guard lock{ m_mutex };
+            m_decoded.push_back(i);
+            m_decodeEnd = Clock::now();
+            ++m_finishedTasks;
+            m_cv.notify_all();
+        });
+    }
+}
+
+bool TextureStreamer::Update(UploadRing& ring, size_t byteBudget, 
+                             const std::function<void(uint32_t request, GLuint texture)>& onReady)
+{
+    PROFILE_FUNCTION();
+    auto start = Clock::now();
+    size_t uploadedBytes = 0;
+    while (uploadedBytes < byteBudget) {
+        uint32_t unique;
+        {
+            std::lock_guard lock{ m_mutex };
+            if (m_decoded.empty()) {
+                break;
+            }
+            unique = m_decoded.back();
+            m_decoded.pop_back();
+        }
+
+        auto& texture = *m_loaded[unique];
+        GLuint handle = 0;
+        size_t textureBytes = 0;
+        if (texture.valid) {
+            if (texture.compressed) {
+                handle = UploadCompressedTexture(texture, ring);
+            }
+            else {
+                const auto& base = texture.levels[0];
+                handle = UploadTexture(ring, base.data.data(), base.width, base.height, texture.channels);
+            }
+
+            for (const auto& level : texture.levels) {
+                textureBytes += level.data.size();
+            }
+            m_rawBytes += texture.rawBytes;
+            m_gpuBytes += textureBytes;
+            m_duplicateBytes += textureBytes * (m_requestsOfUnique[unique].size() - 1);
+            if (texture.fromCache) {
+                ++m_cacheHits;
+            }
+            else if (texture.compressed) {
+                for (const auto& level : texture.levels) {
+                    m_encodedBytes += size_t{ 4 } * level.width * level.height;
+                }
+                m_encodeSeconds += texture.encodeSeconds;
+            }
+        }
+        uploadedBytes += textureBytes;
+
+        // Release the pixel data right away, the whole set does not need to stay resident
+        texture.levels.clear();
+        texture.levels.shrink_to_fit();
+
+        for (uint32_t request : m_requestsOfUnique[unique]) {
+            onReady(request, handle);
+        }
+        ++m_uploaded;
+        if (m_uploaded == m_paths.size()) {
+            m_uploadMs += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1000.f;
+            PrintStats();
+            return true;
+        }
+    }
+    m_uploadMs += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1000.f;
+    return m_uploaded == m_paths.size();
+}
+
+void TextureStreamer::Cancel()
+{
+    m_cancel = true;
+    std::unique_lock lock{ m_mutex };
+    m_cv.wait(lock, [this] { return m_finishedTasks == m_paths.size(); });
+}
+
+void TextureStreamer::PrintStats() const
+{
+    auto ToMs = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.f;
+    };
+    constexpr float MB = 1024.f * 1024.f;
+    std::cout << "--- Textures loaded ---\n";
+    std::cout << "References: " << m_requestCount << ", unique: " << m_paths.size() << '\n';
+    std::cout << "Decode: " << ToMs(m_decodeEnd - m_start) << " ms on " << GetThreadPool().ThreadCount() << " threads\n";
+    std::cout << "Upload: " << m_uploadMs << " ms, spread over frames\n";
+    if (COMPRESS_TEXTURES) {
+        std::cout << "Compressed cache hits: " << m_cacheHits << '/' << m_paths.size() << '\n';
+        if (m_encodeSeconds > 0) {
+            std::cout << "Mip and encode throughput: " << m_encodedBytes / MB / m_encodeSeconds << " MB/s per thread\n";
+        }
+    }
+    std::cout << "VRAM: " << m_gpuBytes / MB << " MB (uncompressed " << m_rawBytes / MB << " MB, saved "
+        << (m_rawBytes - std::min(m_rawBytes, m_gpuBytes)) / MB << " MB by compression, " 
+        << m_duplicateBytes / MB << " MB by deduplication)\n";
+}
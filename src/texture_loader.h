@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class UploadRing;
+struct LoadedTexture;
+
+// Decides the block compression format of a texture
+enum class TextureUsage
+{
+    Color,   // BC1, or BC7 if it has an alpha channel
+    Normal,  // BC5, the shader has to reconstruct z
+    Mask,    // BC4
+    Generic, // picked from the channel count
+};
+
+struct TextureRequest
+{
+    std::filesystem::path path;
+    TextureUsage usage{ TextureUsage::Generic };
+};
+
+// Uncompressed texture with a driver-generated mip chain, the base level goes through the upload ring
+GLuint UploadTexture(UploadRing& ring, const void* img, uint32_t width, uint32_t height, uint32_t channels);
+
+// 1x1 texture standing in for a map of the given usage until the real one is streamed in
+GLuint CreatePlaceholderTexture(UploadRing& ring, TextureUsage usage);
+
+/* Streaming texture loading
+ * 1. Start() canonicalizes the paths, drops duplicates and queues one task per unique image on the thread pool,
+ *    which fetches it from the compressed texture cache, or decodes it, builds the mip chain, 
+ *    block compresses every level and stores the result in the cache
+ * 2. Update() runs on the thread owning the GL context and uploads the finished images through the upload ring
+ * Requests resolving to the same file share a handle.
+ */
+class TextureStreamer
+{
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // May be called from any thread, hasS3TC has to be queried on the GL thread beforehand
+    void Start(const std::vector<TextureRequest>& requests, bool hasS3TC);
+
+    // Upload decoded textures until byteBudget is used up, onReady is called for every request they satisfy
+    // with 0 for images that failed to load. Returns true once all requests have been reported.
+    bool Update(UploadRing& ring, size_t byteBudget, const std::function<void(uint32_t request, GLuint texture)>& onReady);
+
+    // Drop the tasks that did not start yet and wait for the running ones
+    void Cancel();
+
+    uint32_t UniqueCount() const { return static_cast<uint32_t>(m_paths.size()); }
+    uint32_t UploadedCount() const { return m_uploaded; }
+
+private:
+    using Clock = std::chrono::high_resolution_clock;
+
+    void PrintStats() const;
+
+    std::vector<std::string> m_paths;
+    std::vector<TextureUsage> m_usages;
+    std::vector<std::vector<uint32_t>> m_requestsOfUnique;
+    std::vector<std::unique_ptr<LoadedTexture>> m_loaded;
+
+    // Unique indices that finished decoding, guarded by m_mutex
+    std::vector<uint32_t> m_decoded;
+    uint32_t m_finishedTasks{ 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<bool> m_cancel{ false };
+
+    // Statistics, GL thread only except for m_decodeEnd
+    uint32_t m_uploaded{ 0 };
+    uint32_t m_requestCount{ 0 };
+    Clock::time_point m_start;
+    Clock::time_point m_decodeEnd;
+    float m_uploadMs{ 0 };
+    size_t m_rawBytes{ 0 };
+    size_t m_gpuBytes{ 0 };
+    size_t m_encodedBytes{ 0 };
+    size_t m_duplicateBytes{ 0 };
+    uint32_t m_cacheHits{ 0 };
+    float m_encodeSeconds{ 0 };
+};
@@ -0,0 +1,101 @@
+#include "thread_pool.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock{ m_mutex };
+        m_quit = true;
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    {
+        std::lock_guard lock{ m_mutex };
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+{
+    if (count == 0) {
+        return;
+    }
+
+    // Workers pull indices from a shared counter, the state outlives this call
+    // in case a helper task only gets scheduled after all work is done
+    struct State
+    {
+        std::atomic<uint32_t> next{ 0 };
+        std::atomic<uint32_t> done{ 0 };
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+
+    auto run = [state, count, &func] {
+        for (uint32_t i = state->next++; i < count; i = state->next++) {
+            func(i);
+            if (++state->done == count) {
+                std::lock_guard lock{ state->mutex };
+                state->cv.notify_all();
+            }
+        }
+    };
+
+    uint32_t helpers = std::min(count - 1, ThreadCount());
+    for (uint32_t i = 0; i < helpers; ++i) {
+        // func is only dereferenced while indices remain, which cannot outlive this call
+        Submit(run);
+    }
+    run();
+
+    std::unique_lock lock{ state->mutex };
+    state->cv.wait(lock, [&] { return state->done == count; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+    PROFILE_THREAD("Worker");
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock{ m_mutex };
+            m_cv.wait(lock, [this] { return m_quit || !m_tasks.empty(); });
+            if (m_quit && m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+ThreadPool& GetThreadPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads consuming a FIFO task queue
+class ThreadPool
+{
+public:
+    // threadCount == 0 uses one worker per hardware thread
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+
+    // Run func(i) for every i in [0, count) and wait for completion.
+    // The calling thread takes part, so this may be used from inside a task.
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+    uint32_t ThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_quit{ false };
+};
+
+// Process-wide pool shared by the loaders
+ThreadPool& GetThreadPool();
@@ -0,0 +1,202 @@
+#include "upload_ring.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+namespace
+{
+
+constexpr size_t UPLOAD_ALIGNMENT = 16;
+constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000ull;
+
+size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+void UploadRing::Create(size_t capacity)
+{
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    m_capacity = capacity;
+    glCreateBuffers(1, &m_buffer);
+    glNamedBufferStorage(m_buffer, capacity, nullptr, flags);
+    m_mapped = static_cast<uint8_t*>(glMapNamedBufferRange(m_buffer, 0, capacity, flags));
+    if (!m_mapped) {
+        std::cerr << "Failed to map the upload ring\n";
+        std::terminate();
+    }
+    m_head = m_tail = 0;
+    m_pending = false;
+    m_stats = UploadStats{};
+}
+
+void UploadRing::Destroy()
+{
+    for (auto& fence : m_fences) {
+        glDeleteSync(fence.sync);
+    }
+    m_fences.clear();
+    if (m_buffer) {
+        glUnmapNamedBuffer(m_buffer);
+        glDeleteBuffers(1, &m_buffer);
+    }
+    m_buffer = 0;
+    m_mapped = nullptr;
+    m_capacity = 0;
+}
+
+void UploadRing::UploadBuffer(GLuint dstBuffer, size_t dstOffset, const void* data, size_t size)
+{
+    // Quarter-sized chunks keep the copies of a large upload pipelined with the next writes
+    const size_t maxChunk = std::max(m_capacity / 4, UPLOAD_ALIGNMENT);
+    auto src = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        size_t chunk = std::min(size, maxChunk);
+        size_t offset = Allocate(chunk, UPLOAD_ALIGNMENT);
+        std::memcpy(m_mapped + offset, src, chunk);
+        glCopyNamedBufferSubData(m_buffer, dstBuffer, offset, dstOffset, chunk);
+        src += chunk;
+        dstOffset += chunk;
+        size -= chunk;
+    }
+}
+
+void UploadRing::UploadTexture(GLuint texture, uint32_t level, uint32_t width, uint32_t height,
+                               GLenum format, GLenum type, const void* data, size_t size)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (size > m_capacity) {
+        glTextureSubImage2D(texture, level, 0, 0, width, height, format, type, data);
+    }
+    else {
+        size_t offset = Allocate(size, UPLOAD_ALIGNMENT);
+        std::memcpy(m_mapped + offset, data, size);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+        glTextureSubImage2D(texture, level, 0, 0, width, height, format, type, reinterpret_cast<const void*>(offset));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void UploadRing::UploadCompressedTexture(GLuint texture, uint32_t level, uint32_t width, uint32_t height,
+                                         GLenum format, const void* data, size_t size)
+{
+    if (size > m_capacity) {
+        glCompressedTextureSubImage2D(texture, level, 0, 0, width, height, format, static_cast<GLsizei>(size), data);
+        return;
+    }
+
+    size_t offset = Allocate(size, UPLOAD_ALIGNMENT);
+    std::memcpy(m_mapped + offset, data, size);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+    glCompressedTextureSubImage2D(texture, level, 0, 0, width, height, format, static_cast<GLsizei>(size),
+                                  reinterpret_cast<const void*>(offset));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+UploadAllocation UploadRing::AllocateTransient(size_t size, size_t alignment)
+{
+    size_t offset = Allocate(size, std::max(alignment, UPLOAD_ALIGNMENT));
+    return { offset, m_mapped + offset };
+}
+
+void UploadRing::EndFrame()
+{
+    if (m_pending) {
+        InsertFence();
+    }
+    RetireFences(false);
+
+    m_stats.frameBytes = m_frameBytes;
+    m_stats.frameStallMs = m_frameStallMs;
+    m_frameBytes = 0;
+    m_frameStallMs = 0;
+}
+
+size_t UploadRing::Allocate(size_t size, size_t alignment)
+{
+    assert(size <= m_capacity);
+    while (true) {
+        if (!m_pending && m_fences.empty()) {
+            // Nothing in flight, start over from the beginning
+            m_head = m_tail = 0;
+        }
+
+        size_t offset = AlignUp(m_head, alignment);
+        if (!Fits(offset, size) && m_head >= m_tail) {
+            offset = 0; // wrap around, the end of the ring is skipped
+        }
+        if (Fits(offset, size)) {
+            m_head = offset + size;
+            m_pending = true;
+            m_frameBytes += size;
+            m_stats.totalBytes += size;
+            return offset;
+        }
+
+        // Full, the current writes have to be fenced as well before waiting on the oldest region
+        if (m_pending) {
+            InsertFence();
+        }
+        PROFILE_SCOPE("UploadRing stall");
+        auto start = std::chrono::high_resolution_clock::now();
+        RetireFences(true);
+        float stallMs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start).count() / 1000.f;
+        m_frameStallMs += stallMs;
+        m_stats.totalStallMs += stallMs;
+        ++m_stats.stallCount;
+    }
+}
+
+// The in-flight region is [m_tail, m_head), wrapping around when m_head < m_tail
+bool UploadRing::Fits(size_t offset, size_t size) const
+{
+    if (!m_pending && m_fences.empty()) {
+        return offset + size <= m_capacity;
+    }
+    if (m_head > m_tail) {
+        return (offset >= m_head) ? (offset + size <= m_capacity) : (offset + size <= m_tail);
+    }
+    if (m_head < m_tail) {
+        return offset >= m_head && offset + size <= m_tail;
+    }
+    return false;
+}
+
+void UploadRing::InsertFence()
+{
+    m_fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_head });
+    m_pending = false;
+}
+
+void UploadRing::RetireFences(bool waitForOldest)
+{
+    while (!m_fences.empty()) {
+        GLenum status = glClientWaitSync(m_fences.front().sync, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                         waitForOldest ? FENCE_TIMEOUT_NS : 0);
+        if (status == GL_WAIT_FAILED) {
+            std::cerr << "Waiting on an upload fence failed\n";
+            std::terminate();
+        }
+        if (status == GL_TIMEOUT_EXPIRED) {
+            if (waitForOldest) {
+                continue;
+            }
+            break;
+        }
+
+        m_tail = m_fences.front().head;
+        glDeleteSync(m_fences.front().sync);
+        m_fences.pop_front();
+        waitForOldest = false;
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Space in the ring the GPU reads directly, valid until the end of the frame it was allocated in
+struct UploadAllocation
+{
+    size_t offset{ 0 };
+    void* data{ nullptr };
+};
+
+struct UploadStats
+{
+    size_t frameBytes{ 0 };      // written during the last completed frame
+    float frameStallMs{ 0 };     // spent waiting on fences during the last completed frame
+    uint64_t totalBytes{ 0 };
+    float totalStallMs{ 0 };
+    uint32_t stallCount{ 0 };
+};
+
+/* Staging memory for CPU -> GPU uploads
+ * One persistently and coherently mapped buffer sub-allocated as a ring. Data is written straight into
+ * the mapping and copied into its destination by the GPU, regions are recycled once the fence of the
+ * frame that used them has signaled. Allocation blocks on the oldest fence when the ring is full.
+ * Must be used from the thread owning the GL context, Destroy() has to be called while it is still current.
+ */
+class UploadRing
+{
+public:
+    UploadRing() = default;
+
+    UploadRing(const UploadRing&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+
+    void Create(size_t capacity);
+    void Destroy();
+
+    // Copy size bytes into dstBuffer at dstOffset, uploads larger than the ring are split
+    void UploadBuffer(GLuint dstBuffer, size_t dstOffset, const void* data, size_t size);
+
+    // Upload one level of a texture through the ring bound as pixel unpack buffer, rows are tightly packed
+    void UploadTexture(GLuint texture, uint32_t level, uint32_t width, uint32_t height,
+                       GLenum format, GLenum type, const void* data, size_t size);
+    void UploadCompressedTexture(GLuint texture, uint32_t level, uint32_t width, uint32_t height,
+                                 GLenum format, const void* data, size_t size);
+
+    // Per-frame data consumed in place, e.g. indirect draw commands or uniform blocks bound with Buffer()
+    UploadAllocation AllocateTransient(size_t size, size_t alignment);
+
+    // Fence everything written since the previous call and recycle completed regions, call once per frame
+    void EndFrame();
+
+    GLuint Buffer() const { return m_buffer; }
+    size_t Capacity() const { return m_capacity; }
+    const UploadStats& Stats() const { return m_stats; }
+
+private:
+    struct Fence
+    {
+        GLsync sync;
+        size_t head; // ring head when the fence was inserted
+    };
+
+    // Returns the offset of size free bytes, waits for the GPU if necessary
+    size_t Allocate(size_t size, size_t alignment);
+    bool Fits(size_t offset, size_t size) const;
+    void InsertFence();
+    void RetireFences(bool wait);
+
+    GLuint m_buffer{ 0 };
+    uint8_t* m_mapped{ nullptr };
+    size_t m_capacity{ 0 };
+    size_t m_head{ 0 };
+    size_t m_tail{ 0 };
+    bool m_pending{ false }; // data written since the last fence
+    std::deque<Fence> m_fences;
+
+    UploadStats m_stats;
+    size_t m_frameBytes{ 0 };
+    float m_frameStallMs{ 0 };
+};
@@ -1,10 +1,39 @@
 #include "utils.h"
 
+#include <glad/gl.h>
 #include <glm/glm.hpp>
 #include <assimp/Importer.hpp>
 
+#include <cstring>
+
 template <>
 glm::vec3 Cast(const aiVector3D& src)
 {
     return glm::vec3{ src.x, src.y, src.z };
 }
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+    constexpr uint64_t FNV1A_PRIME = 0x100000001b3ull;
+
+    auto bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+bool HasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        auto extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,5 +1,15 @@
 #pragma once
 
+#include <cstdint>
+#include <cstddef>
+
 template <typename Dst, typename Src>
 Dst Cast(const Src& src);
 
+constexpr uint64_t FNV1A_OFFSET_BASIS = 0xcbf29ce484222325ull;
+
+// 64-bit FNV-1a, pass the previous result as seed to hash several blocks in sequence
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = FNV1A_OFFSET_BASIS);
+
+// Needs a current GL context
+bool HasGLExtension(const char* name);
@@ -0,0 +1,86 @@
+#include "vertex_packing.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+glm::vec2 OctEncode(glm::vec3 n)
+{
+    n /= (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    glm::vec2 e{ n.x, n.y };
+    if (n.z < 0) {
+        // Fold the lower hemisphere over the diagonals
+        e = (1.f - glm::abs(glm::vec2{ n.y, n.x })) * glm::vec2{ n.x >= 0 ? 1.f : -1.f, n.y >= 0 ? 1.f : -1.f };
+    }
+    return e;
+}
+
+glm::vec3 OctDecode(glm::vec2 e)
+{
+    glm::vec3 n{ e.x, e.y, 1.f - std::abs(e.x) - std::abs(e.y) };
+    if (n.z < 0) {
+        glm::vec2 folded = (1.f - glm::abs(glm::vec2{ n.y, n.x })) * glm::vec2{ n.x >= 0 ? 1.f : -1.f, n.y >= 0 ? 1.f : -1.f };
+        n.x = folded.x;
+        n.y = folded.y;
+    }
+    return glm::normalize(n);
+}
+
+void PackVertices(const SceneView& scene, std::vector<PackedVertex>& outVertices)
+{
+    outVertices.resize(scene.vertexCount);
+    for (uint32_t i = 0; i < scene.meshCount; ++i) {
+        const auto& mesh = scene.meshes[i];
+        glm::vec3 aabbMin{ mesh.aabbMin };
+        glm::vec3 extent = glm::max(glm::vec3{ mesh.aabbMax } - aabbMin, glm::vec3{ 1e-6f });
+
+        for (uint32_t j = 0; j < mesh.vertexCount; ++j) {
+            const auto& src = scene.vertices[mesh.firstVertex + j];
+            auto& dst = outVertices[mesh.firstVertex + j];
+
+            glm::vec3 p = glm::clamp((src.position - aabbMin) / extent, glm::vec3{ 0 }, glm::vec3{ 1 });
+            dst.position[0] = glm::packUnorm1x16(p.x);
+            dst.position[1] = glm::packUnorm1x16(p.y);
+            dst.position[2] = glm::packUnorm1x16(p.z);
+            dst.position[3] = 0;
+
+            glm::vec3 n = src.normal;
+            glm::vec2 e = (glm::dot(n, n) > 0) ? OctEncode(n) : glm::vec2{ 0 };
+            dst.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(e.x));
+            dst.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(e.y));
+
+            dst.texCoord[0] = glm::packHalf1x16(src.texCoord.x);
+            dst.texCoord[1] = glm::packHalf1x16(src.texCoord.y);
+        }
+    }
+}
+
+void PackIndices(const SceneView& scene, std::vector<uint8_t>& outIndices, std::vector<PackedIndexRange>& outRanges)
+{
+    outIndices.clear();
+    outRanges.resize(scene.meshCount);
+
+    for (uint32_t i = 0; i < scene.meshCount; ++i) {
+        const auto& mesh = scene.meshes[i];
+        const uint32_t* indices = scene.indices + mesh.firstIndex;
+        auto& range = outRanges[i];
+        range.indexSize = (mesh.vertexCount <= 0x10000) ? 2 : 4;
+
+        // Index offsets have to be a multiple of the index size
+        size_t offset = (outIndices.size() + range.indexSize - 1) / range.indexSize * range.indexSize;
+        range.byteOffset = static_cast<uint32_t>(offset);
+        outIndices.resize(offset + size_t{ mesh.indexCount } * range.indexSize);
+
+        uint8_t* dst = outIndices.data() + offset;
+        if (range.indexSize == 2) {
+            for (uint32_t j = 0; j < mesh.indexCount; ++j) {
+                auto index = static_cast<uint16_t>(indices[j]);
+                std::memcpy(dst + 2 * j, &index, 2);
+            }
+        }
+        else {
+            std::memcpy(dst, indices, size_t{ mesh.indexCount } * 4);
+        }
+    }
+}
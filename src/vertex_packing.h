@@ -0,0 +1,35 @@
+#pragma once
+
+#include "scene.h"
+
+#include <cstdint>
+#include <vector>
+
+/* Packed vertex layout, 16 bytes instead of 32
+ * position: unorm16 x3 relative to the mesh AABB, decoded with u_meshAABB
+ * normal:   octahedral snorm16 x2
+ * texCoord: half float x2
+ */
+struct PackedVertex
+{
+    uint16_t position[4]; // w is padding
+    int16_t normal[2];
+    uint16_t texCoord[2];
+};
+static_assert(sizeof(PackedVertex) == 16);
+
+// Where the indices of a mesh live in the packed index buffer
+struct PackedIndexRange
+{
+    uint32_t byteOffset{ 0 };
+    uint32_t indexSize{ 4 }; // 2 when every index of the mesh fits in 16 bits
+};
+
+glm::vec2 OctEncode(glm::vec3 n);
+glm::vec3 OctDecode(glm::vec2 e);
+
+// Vertices keep their order, so the baseVertex of a mesh is the same in both layouts
+void PackVertices(const SceneView& scene, std::vector<PackedVertex>& outVertices);
+
+// Meshes with fewer than 65536 vertices get 16-bit indices, outRanges has one entry per mesh
+void PackIndices(const SceneView& scene, std::vector<uint8_t>& outIndices, std::vector<PackedIndexRange>& outRanges);
@@ -0,0 +1,167 @@
+#include "voxel_mipmap.h"
+#include "profiler.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr const char* VOXEL_MIPMAP_CS_PATH = "resources/shaders/voxel_mipmap.comp";
+constexpr float MB = 1024.f * 1024.f;
+
+// GPU timer of the dispatch writing levels [firstLevel, firstLevel + levels), GpuTimers keeps the pointer
+const char* TimerName(uint32_t firstLevel, uint32_t levels)
+{
+    static const auto names = [] {
+        std::vector<std::string> result(VoxelMipmap::MAX_LEVELS * VoxelMipmap::MAX_LEVELS_PER_DISPATCH);
+        for (uint32_t first = 0; first < VoxelMipmap::MAX_LEVELS; ++first) {
+            for (uint32_t count = 1; count <= VoxelMipmap::MAX_LEVELS_PER_DISPATCH; ++count) {
+                result[first * VoxelMipmap::MAX_LEVELS_PER_DISPATCH + count - 1] = (count == 1) ? 
+                    "Voxel mip " + std::to_string(first) :
+                    "Voxel mips " + std::to_string(first) + "-" + std::to_string(first + count - 1);
+            }
+        }
+        return result;
+    }();
+    return names[firstLevel * VoxelMipmap::MAX_LEVELS_PER_DISPATCH + levels - 1].c_str();
+}
+
+}
+
+void VoxelMipmap::SubmitShaders(ShaderCompiler& compiler)
+{
+    for (int fromBase = 0; fromBase < 2; ++fromBase) {
+        for (uint32_t levels = 1; levels <= MAX_LEVELS_PER_DISPATCH; ++levels) {
+            compiler.Submit(m_programs[fromBase][levels - 1], "voxel_mipmap", 
+                            { { VOXEL_MIPMAP_CS_PATH, GL_COMPUTE_SHADER } }, false,
+                            { MakeDefine("FROM_BASE", fromBase), MakeDefine("MIP_LEVELS", levels) });
+        }
+    }
+}
+
+bool VoxelMipmap::IsReady(const ShaderCompiler& compiler, uint32_t levelsPerDispatch) const
+{
+    // The last dispatch of a build may write fewer levels
+    for (uint32_t levels = 1; levels <= levelsPerDispatch; ++levels) {
+        if (!compiler.IsReady(Program(true, levels)) || !compiler.IsReady(Program(false, levels))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void VoxelMipmap::Create(uint32_t baseResolution)
+{
+    m_baseResolution = baseResolution;
+    const uint32_t resolution = Resolution();
+    m_levelCount = 1;
+    while ((resolution >> m_levelCount) > 0 && m_levelCount < MAX_LEVELS) {
+        ++m_levelCount;
+    }
+
+    glCreateTextures(GL_TEXTURE_3D, 1, &m_texture);
+    glTextureStorage3D(m_texture, m_levelCount, GL_RGBA8, DIRECTIONS * resolution, resolution, resolution);
+    glTextureParameteri(m_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(m_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    for (uint32_t level = 0; level < m_levelCount; ++level) {
+        glClearTexImage(m_texture, level, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    MarkAllDirty();
+}
+
+void VoxelMipmap::Destroy()
+{
+    glDeleteTextures(1, &m_texture);
+    m_texture = 0;
+    m_dirty = false;
+}
+
+void VoxelMipmap::MarkDirty(const glm::uvec3& first, const glm::uvec3& last)
+{
+    m_dirtyFirst = m_dirty ? glm::min(m_dirtyFirst, first) : first;
+    m_dirtyLast = m_dirty ? glm::max(m_dirtyLast, last) : last;
+    m_dirty = true;
+}
+
+void VoxelMipmap::MarkAllDirty()
+{
+    m_dirtyFirst = glm::uvec3{ 0 };
+    m_dirtyLast = glm::uvec3{ m_baseResolution - 1 };
+    m_dirty = true;
+}
+
+void VoxelMipmap::Update(const ShaderCompiler& compiler, GpuTimers& timers, uint32_t levelsPerDispatch, bool dirtyRegionOnly)
+{
+    PROFILE_FUNCTION();
+    levelsPerDispatch = std::clamp(levelsPerDispatch, 1u, MAX_LEVELS_PER_DISPATCH);
+    if (!m_dirty || !IsReady(compiler, levelsPerDispatch)) {
+        return;
+    }
+
+    glm::uvec3 first = dirtyRegionOnly ? m_dirtyFirst : glm::uvec3{ 0 };
+    glm::uvec3 last = dirtyRegionOnly ? m_dirtyLast : glm::uvec3{ m_baseResolution - 1 };
+    const glm::uvec3 extent = last - first + 1u;
+    m_stats.baseVoxels = uint64_t{ extent.x } * extent.y * extent.z;
+    m_stats.partialBuilds += (m_stats.baseVoxels < uint64_t{ m_baseResolution } * m_baseResolution * m_baseResolution);
+    ++m_stats.builds;
+    m_stats.dispatches = 0;
+
+    glBindTextureUnit(VOXEL_MIP_TEXTURE_UNIT, m_texture);
+    uint32_t sourceResolution = m_baseResolution;
+    for (uint32_t level = 0; level < m_levelCount;) {
+        const uint32_t levels = std::min(levelsPerDispatch, m_levelCount - level);
+        ScopedGpuTimer gpuTimer{ timers, TimerName(level, levels) };
+        GLuint program = Program(level == 0, levels);
+        const auto& reflection = compiler.Reflection(program);
+        glUseProgram(program);
+
+        // first and last are in voxels of the source level, a group covers GROUP_SOURCE_SIZE^3 of them
+        const glm::uvec3 firstGroup = first / GROUP_SOURCE_SIZE;
+        const glm::uvec3 groups = last / GROUP_SOURCE_SIZE - firstGroup + 1u;
+        glProgramUniform3i(program, reflection.Location("u_groupOffset"), firstGroup.x, firstGroup.y, firstGroup.z);
+        glProgramUniform1i(program, reflection.Location("u_sourceResolution"), sourceResolution);
+        if (level > 0) {
+            glProgramUniform1i(program, reflection.Location("u_sourceLevel"), level - 1);
+        }
+        for (uint32_t i = 0; i < levels; ++i) {
+            glBindImageTexture(VOXEL_MIP_IMAGE_BINDING + i, m_texture, level + i, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        }
+        glDispatchCompute(groups.x, groups.y, groups.z);
+        // The next dispatch fetches the last level written here, the cone tracers sample all of them
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        first >>= levels;
+        last >>= levels;
+        sourceResolution >>= levels;
+        level += levels;
+        ++m_stats.dispatches;
+    }
+    m_dirty = false;
+}
+
+void VoxelMipmap::Bind() const
+{
+    glBindTextureUnit(VOXEL_MIP_TEXTURE_UNIT, m_texture);
+}
+
+void VoxelMipmap::Draw() const
+{
+    const uint32_t resolution = Resolution();
+    double bytes = 0;
+    for (uint32_t level = 0; level < m_levelCount; ++level) {
+        double levelResolution = resolution >> level;
+        bytes += DIRECTIONS * levelResolution * levelResolution * levelResolution * 4;
+    }
+    const double baseVoxels = double(m_baseResolution) * m_baseResolution * m_baseResolution;
+    ImGui::Text("Resolution: %u^3 x %u directions, %u levels, %.1f MB", resolution, DIRECTIONS, m_levelCount, bytes / MB);
+    ImGui::Text("Builds: %u (%u partial), %u dispatches", m_stats.builds, m_stats.partialBuilds, m_stats.dispatches);
+    ImGui::Text("Last refilter: %.2f%% of the base volume", 100.0 * m_stats.baseVoxels / baseVoxels);
+    ImGui::Text("Per-level GPU times are listed under GPU passes");
+}
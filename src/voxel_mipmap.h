@@ -0,0 +1,79 @@
+#pragma once
+
+#include "gpu_timer.h"
+#include "shader_compiler.h"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// Bindings of voxel_mipmap.comp, the levels written by one dispatch take the image units from VOXEL_MIP_IMAGE_BINDING on
+constexpr GLuint VOXEL_MIP_IMAGE_BINDING = 1;
+constexpr GLuint VOXEL_MIP_TEXTURE_UNIT = 8; // after the material maps
+
+struct VoxelMipmapStats
+{
+    uint32_t builds{ 0 };
+    uint32_t partialBuilds{ 0 };
+    uint32_t dispatches{ 0 }; // of the last build
+    uint64_t baseVoxels{ 0 }; // of the base volume refiltered by the last build
+};
+
+/* Anisotropic mip chain of the voxel volume for cone tracing
+ * A separate RGBA8 volume with premultiplied radiance and opacity, level 0 has half the resolution of
+ * the R32UI volume the voxelizers write. Every level stores the voxels as seen along each of the six axis
+ * directions, side by side in one 3D texture, so a single texture with regular mipmaps holds all six
+ * chains, see include/voxel_mipmap.glsl. voxel_mipmap.comp builds up to MAX_LEVELS_PER_DISPATCH levels
+ * per dispatch with shared memory reductions.
+ * Changes of the base volume are collected with MarkDirty, Update refilters the levels above the dirty
+ * region only, or everything when asked to. Every dispatch is a GPU timer named after its levels.
+ */
+class VoxelMipmap
+{
+public:
+    static constexpr uint32_t DIRECTIONS = 6;
+    static constexpr uint32_t MAX_LEVELS = 12;
+    static constexpr uint32_t MAX_LEVELS_PER_DISPATCH = 3;
+    static constexpr uint32_t GROUP_SOURCE_SIZE = 8; // source voxels per axis of one workgroup
+
+    void SubmitShaders(ShaderCompiler& compiler);
+    bool IsReady(const ShaderCompiler& compiler, uint32_t levelsPerDispatch) const;
+
+    // baseResolution is the one of the R32UI volume, a power of two
+    void Create(uint32_t baseResolution);
+    void Destroy();
+    bool IsCreated() const { return m_texture != 0; }
+
+    GLuint Texture() const { return m_texture; }
+    uint32_t Resolution() const { return m_baseResolution / 2; } // of level 0, per direction
+    uint32_t LevelCount() const { return m_levelCount; }
+
+    // Base voxels [first, last] changed, regions of several changes are merged
+    void MarkDirty(const glm::uvec3& first, const glm::uvec3& last);
+    void MarkAllDirty();
+    bool IsDirty() const { return m_dirty; }
+
+    // Refilters the dirty region from the R32UI volume bound at VOXEL_IMAGE_BINDING once the programs are ready
+    void Update(const ShaderCompiler& compiler, GpuTimers& timers, uint32_t levelsPerDispatch, bool dirtyRegionOnly);
+
+    // The volume at VOXEL_MIP_TEXTURE_UNIT with trilinear filtering between levels
+    void Bind() const;
+
+    const VoxelMipmapStats& Stats() const { return m_stats; }
+    void Draw() const;
+
+private:
+    GLuint Program(bool fromBase, uint32_t levels) const { return m_programs[fromBase][levels - 1]; }
+
+    GLuint m_programs[2][MAX_LEVELS_PER_DISPATCH]{}; // indexed by FROM_BASE and MIP_LEVELS - 1
+    uint32_t m_baseResolution{ 0 };
+    uint32_t m_levelCount{ 0 };
+    GLuint m_texture{ 0 };
+
+    bool m_dirty{ false };
+    glm::uvec3 m_dirtyFirst{ 0 };
+    glm::uvec3 m_dirtyLast{ 0 };
+
+    VoxelMipmapStats m_stats;
+};
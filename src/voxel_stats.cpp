@@ -0,0 +1,197 @@
+#include "voxel_stats.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+
+// Order of Slot::queries
+constexpr GLenum QUERY_TARGETS[] = {
+    GL_PRIMITIVES_SUBMITTED,
+    GL_GEOMETRY_SHADER_PRIMITIVES_EMITTED,
+    GL_CLIPPING_OUTPUT_PRIMITIVES,
+    GL_FRAGMENT_SHADER_INVOCATIONS,
+};
+
+constexpr uint32_t COUNTER_COUNT = 2; // writes, collisions
+
+}
+
+void VoxelStats::Create()
+{
+    static_assert(std::size(QUERY_TARGETS) == QUERY_COUNT);
+    for (auto& slot : m_slots) {
+        for (uint32_t i = 0; i < QUERY_COUNT; ++i) {
+            glCreateQueries(QUERY_TARGETS[i], 1, &slot.queries[i]);
+        }
+    }
+
+    glCreateBuffers(1, &m_counterBuffer);
+    glNamedBufferStorage(m_counterBuffer, COUNTER_COUNT * sizeof(uint32_t), nullptr, 0);
+
+    constexpr GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    constexpr size_t readbackSize = FRAME_LATENCY * COUNTER_COUNT * sizeof(uint32_t);
+    glCreateBuffers(1, &m_readbackBuffer);
+    glNamedBufferStorage(m_readbackBuffer, readbackSize, nullptr, flags);
+    m_readback = static_cast<const uint32_t*>(glMapNamedBufferRange(m_readbackBuffer, 0, readbackSize, flags));
+}
+
+void VoxelStats::Destroy()
+{
+    for (auto& slot : m_slots) {
+        glDeleteQueries(QUERY_COUNT, slot.queries);
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        slot = Slot{};
+    }
+    glUnmapNamedBuffer(m_readbackBuffer);
+    glDeleteBuffers(1, &m_readbackBuffer);
+    glDeleteBuffers(1, &m_counterBuffer);
+    m_readback = nullptr;
+}
+
+void VoxelStats::Begin(uint32_t resolution, const char* engine)
+{
+    auto& slot = m_slots[m_run % FRAME_LATENCY];
+    if (slot.fence) {
+        Resolve(slot);
+    }
+    slot.resolution = resolution;
+    slot.engine = engine;
+
+    uint32_t zero = 0;
+    glClearNamedBufferSubData(m_counterBuffer, GL_R32UI, 0, COUNTER_COUNT * sizeof(uint32_t),
+                              GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, VOXEL_COUNTER_BINDING, m_counterBuffer);
+    for (uint32_t i = 0; i < QUERY_COUNT; ++i) {
+        glBeginQuery(QUERY_TARGETS[i], slot.queries[i]);
+    }
+}
+
+void VoxelStats::End()
+{
+    auto& slot = m_slots[m_run % FRAME_LATENCY];
+    for (uint32_t i = 0; i < QUERY_COUNT; ++i) {
+        glEndQuery(QUERY_TARGETS[i]);
+    }
+
+    // The copy reads what the shader atomics wrote
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glCopyNamedBufferSubData(m_counterBuffer, m_readbackBuffer, 0,
+                             (m_run % FRAME_LATENCY) * COUNTER_COUNT * sizeof(uint32_t), COUNTER_COUNT * sizeof(uint32_t));
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++m_run;
+}
+
+void VoxelStats::Resolve(Slot& slot)
+{
+    GLenum status = glClientWaitSync(slot.fence, 0, 0);
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return; // not done after FRAME_LATENCY runs, drop it rather than stall
+    }
+
+    GLuint64 results[QUERY_COUNT];
+    for (uint32_t i = 0; i < QUERY_COUNT; ++i) {
+        glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &results[i]);
+    }
+    const uint32_t* counters = m_readback + (&slot - m_slots) * COUNTER_COUNT;
+
+    VoxelRunStats stats;
+    stats.engine = slot.engine;
+    stats.resolution = slot.resolution;
+    stats.trianglesSubmitted = results[0];
+    stats.gsPrimitivesEmitted = results[1];
+    stats.primitivesRasterized = results[2];
+    stats.fragmentInvocations = results[3];
+    stats.voxelWrites = counters[0];
+    stats.voxelCollisions = counters[1];
+    m_last = stats;
+    m_runs.push_back(stats);
+    auto last = std::find_if(m_lastPerEngine.begin(), m_lastPerEngine.end(), [&](const VoxelRunStats& run) {
+        return std::strcmp(run.engine, stats.engine) == 0;
+    });
+    if (last != m_lastPerEngine.end()) {
+        *last = stats;
+    }
+    else {
+        m_lastPerEngine.push_back(stats);
+    }
+}
+
+bool VoxelStats::WriteCsv(const std::filesystem::path& path) const
+{
+    std::ofstream ofs{ path };
+    if (!ofs.is_open()) {
+        return false;
+    }
+    ofs << "run,engine,resolution,triangles,gs_primitives,rasterized_primitives,fs_invocations,voxel_writes,collisions,occupied\n";
+    for (size_t i = 0; i < m_runs.size(); ++i) {
+        const auto& run = m_runs[i];
+        ofs << i << ',' << run.engine << ',' << run.resolution << ',' << run.trianglesSubmitted << ',' << run.gsPrimitivesEmitted << ','
+            << run.primitivesRasterized << ',' << run.fragmentInvocations << ',' << run.voxelWrites << ','
+            << run.voxelCollisions << ',' << run.OccupiedVoxels() << '\n';
+    }
+    return ofs.good();
+}
+
+void VoxelStats::Draw()
+{
+    const auto& run = m_last;
+    if (run.resolution == 0) {
+        ImGui::Text("No run resolved yet");
+        return;
+    }
+
+    double voxelCount = double(run.resolution) * run.resolution * run.resolution;
+    uint32_t occupied = run.OccupiedVoxels();
+    ImGui::Text("Engine: %s", run.engine);
+    ImGui::Text("Triangles submitted: %llu", static_cast<unsigned long long>(run.trianglesSubmitted));
+    ImGui::Text("GS primitives emitted: %llu, rasterized: %llu", static_cast<unsigned long long>(run.gsPrimitivesEmitted),
+                static_cast<unsigned long long>(run.primitivesRasterized));
+    ImGui::Text("FS invocations: %llu", static_cast<unsigned long long>(run.fragmentInvocations));
+    ImGui::Text("Voxel writes: %u, collisions: %u (%.1f%%)", run.voxelWrites, run.voxelCollisions,
+                run.voxelWrites ? 100.0 * run.voxelCollisions / run.voxelWrites : 0.0);
+    ImGui::Text("Occupied voxels: %u of %u^3 (%.3f%%)", occupied, run.resolution, 100.0 * occupied / voxelCount);
+    ImGui::Text("FS invocations per occupied voxel: %.2f", occupied ? double(run.fragmentInvocations) / occupied : 0.0);
+
+    // Last run of every engine side by side, the pipeline counters of a compute engine stay 0
+    if (m_lastPerEngine.size() > 1 && ImGui::BeginTable("Engines", 5)) {
+        ImGui::TableSetupColumn("Engine");
+        ImGui::TableSetupColumn("Resolution");
+        ImGui::TableSetupColumn("Writes");
+        ImGui::TableSetupColumn("Collisions");
+        ImGui::TableSetupColumn("Occupied");
+        ImGui::TableHeadersRow();
+        for (const auto& engineRun : m_lastPerEngine) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", engineRun.engine);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", engineRun.resolution);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", engineRun.voxelWrites);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", engineRun.voxelCollisions);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", engineRun.OccupiedVoxels());
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Text("Runs recorded: %u", static_cast<uint32_t>(m_runs.size()));
+    if (ImGui::Button("Write voxel stats")) {
+        if (WriteCsv(VOXEL_STATS_PATH)) {
+            std::cout << "Voxel stats of " << m_runs.size() << " runs written to " << VOXEL_STATS_PATH << '\n';
+        }
+        ClearRuns();
+    }
+}
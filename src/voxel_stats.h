@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Binding of the atomic counters written by voxelize.frag
+constexpr GLuint VOXEL_COUNTER_BINDING = 0;
+constexpr const char* VOXEL_STATS_PATH = "voxel_stats.csv";
+
+// Work done by one voxelization run
+struct VoxelRunStats
+{
+    const char* engine{ "" };
+    uint32_t resolution{ 0 };
+    uint64_t trianglesSubmitted{ 0 };
+    uint64_t gsPrimitivesEmitted{ 0 };
+    uint64_t primitivesRasterized{ 0 };  // after clipping
+    uint64_t fragmentInvocations{ 0 };
+    uint32_t voxelWrites{ 0 };
+    uint32_t voxelCollisions{ 0 };       // writes to a voxel that was already set in this run
+    uint32_t OccupiedVoxels() const { return voxelWrites - voxelCollisions; }
+};
+
+/* Voxelization statistics
+ * Pipeline statistics queries count the primitives and fragment shader invocations of a run,
+ * voxelize.frag counts its image writes and the writes that hit an occupied voxel with atomic counters.
+ * Both are read back FRAME_LATENCY runs later through a persistently mapped buffer, so nothing stalls.
+ * The voxel volume must be cleared before a measured run for the collision count to be meaningful.
+ */
+class VoxelStats
+{
+public:
+    static constexpr uint32_t FRAME_LATENCY = 3;
+
+    void Create();
+    void Destroy();
+
+    // Bracket one voxelization run, the counters are reset and bound to VOXEL_COUNTER_BINDING.
+    // engine names the voxelizer for comparisons and must have static storage duration.
+    void Begin(uint32_t resolution, const char* engine);
+    void End();
+
+    const VoxelRunStats& Last() const { return m_last; }
+    const std::vector<VoxelRunStats>& Runs() const { return m_runs; }
+
+    // One row per resolved run
+    bool WriteCsv(const std::filesystem::path& path) const;
+    void ClearRuns() { m_runs.clear(); }
+
+    void Draw();
+
+private:
+    static constexpr uint32_t QUERY_COUNT = 4;
+
+    struct Slot
+    {
+        GLuint queries[QUERY_COUNT]{ 0 };
+        GLsync fence{ nullptr };
+        uint32_t resolution{ 0 };
+        const char* engine{ "" };
+    };
+
+    void Resolve(Slot& slot);
+
+    Slot m_slots[FRAME_LATENCY];
+    uint32_t m_run{ 0 };
+    GLuint m_counterBuffer{ 0 };
+    GLuint m_readbackBuffer{ 0 };
+    const uint32_t* m_readback{ nullptr };
+
+    VoxelRunStats m_last;
+    std::vector<VoxelRunStats> m_lastPerEngine;
+    std::vector<VoxelRunStats> m_runs;
+};